@@ -6,12 +6,26 @@
 #include <boost/python/class.hpp>
 #include <boost/python/module.hpp>
 #include <boost/python/enum.hpp>
+#include <boost/python/errors.hpp>
+#include <boost/python/object.hpp>
 #include "python_qt_wrappers.h"
 #include <KOpeningHours/OpeningHours>
 
 using namespace boost::python;
 using namespace KOpeningHours;
 
+// parse directly from the UTF-8 representation Python keeps for the string, rather than
+// converting to a temporary QByteArray first
+static void setExpression(OpeningHours &openingHours, const object &expression, OpeningHours::Modes modes)
+{
+    Py_ssize_t size = 0;
+    const char *utf8 = PyUnicode_AsUTF8AndSize(expression.ptr(), &size);
+    if (!utf8) {
+        throw_error_already_set();
+    }
+    openingHours.setExpression(utf8, std::size_t(size), modes);
+}
+
 BOOST_PYTHON_MODULE(PyKOpeningHours)
 {
     register_qt_wrappers();
@@ -21,10 +35,8 @@ BOOST_PYTHON_MODULE(PyKOpeningHours)
             .value("PointInTimeMode", OpeningHours::PointInTimeMode);
     class_<OpeningHours::Modes>("Modes", init<OpeningHours::Mode>());
 
-    // select the right overload of setExpression
-    using SetExpressionFunc = void(OpeningHours::*)(const QByteArray&,OpeningHours::Modes);
     class_<OpeningHours>("OpeningHours", init<>())
-        .def("setExpression", static_cast<SetExpressionFunc>(&OpeningHours::setExpression),
+        .def("setExpression", &setExpression,
              (arg("expression"), arg("modes")=OpeningHours::Modes{OpeningHours::IntervalMode}))
         .def("error", &OpeningHours::error)
         .def("normalizedExpression", &OpeningHours::normalizedExpression);
@@ -0,0 +1,51 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <../src/lib/civildate_p.h>
+
+#include <QDate>
+#include <QTest>
+
+using namespace KOpeningHours;
+
+static_assert(CivilDate::toJulianDay(1970, 1, 1) == CivilDate::UnixEpochJulianDay, "");
+static_assert(CivilDate::dayOfWeek(CivilDate::UnixEpochJulianDay) == 4, "");
+static_assert(CivilDate::daysInMonth(2024, 2) == 29 && CivilDate::daysInMonth(2100, 2) == 28 && CivilDate::daysInMonth(2000, 2) == 29, "");
+
+class CivilDateTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testCompareToQDate()
+    {
+        for (auto date = QDate(1582, 10, 15); date.year() < 2500; date = date.addDays(1)) {
+            const auto jd = date.toJulianDay();
+            QCOMPARE(CivilDate::toJulianDay(date.year(), date.month(), date.day()), jd);
+            const auto d = CivilDate::fromJulianDay(jd);
+            QCOMPARE(d.year, date.year());
+            QCOMPARE(d.month, date.month());
+            QCOMPARE(d.day, date.day());
+            QCOMPARE(CivilDate::dayOfWeek(jd), date.dayOfWeek());
+            QCOMPARE(CivilDate::weekNumber(jd), date.weekNumber());
+            QCOMPARE(CivilDate::daysInMonth(d.year, d.month), date.daysInMonth());
+        }
+    }
+
+    void testFirstDayInWeekOne()
+    {
+        for (int year = 1900; year < 2200; ++year) {
+            auto date = QDate(year, 1, 1);
+            while (date.weekNumber() != 1) {
+                date = date.addDays(1);
+            }
+            QCOMPARE(CivilDate::firstDayInWeekOne(year), date.toJulianDay());
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(CivilDateTest)
+
+#include "civildatetest.moc"
@@ -0,0 +1,104 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <KOpeningHours/Interval>
+#include <KOpeningHours/OpeningHours>
+
+#include <QDirIterator>
+#include <QFile>
+#include <QTest>
+#include <QTimeZone>
+
+#include <vector>
+
+using namespace KOpeningHours;
+
+void initLocale()
+{
+    qputenv("TZ", "Europe/Berlin");
+}
+
+Q_CONSTRUCTOR_FUNCTION(initLocale)
+
+/** Evaluation benchmark on the expressions of the iteration test data.
+ *  Run this a second time with KOPENINGHOURS_NO_WEEKLY_EVALUATOR set,
+ *  to compare the weekly evaluator fast path with the full evaluator.
+ */
+class EvaluateBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    std::vector<OpeningHours> m_expressions;
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QDirIterator it(QStringLiteral(SOURCE_DIR "/data"), {QStringLiteral("*.intervals")}, QDir::Files | QDir::Readable | QDir::NoSymLinks);
+        while (it.hasNext()) {
+            QFile f(it.next());
+            QVERIFY(f.open(QFile::ReadOnly));
+            OpeningHours oh(f.readLine().trimmed());
+            oh.setLocation(52.5, 13.0);
+            oh.setRegion(QStringLiteral("DE-BE"));
+            oh.setTimeZone(QTimeZone("Europe/Berlin"));
+            if (oh.error() == OpeningHours::NoError) {
+                m_expressions.push_back(oh);
+            }
+        }
+        QVERIFY(!m_expressions.empty());
+    }
+
+    void benchmarkInterval_data()
+    {
+        QTest::addColumn<QByteArray>("expr");
+        QTest::newRow("time only") << QByteArray("10:00-18:00");
+        QTest::newRow("weekdays") << QByteArray("Mo-Fr 08:00-12:00,13:00-17:30; Sa 08:00-12:00");
+        QTest::newRow("closed rules") << QByteArray("10:00-15:00, We 12:00-13:00 closed, Tu-Th 11:00-12:30 closed");
+        QTest::newRow("midnight") << QByteArray("Fr,Sa 22:00-04:00");
+        QTest::newRow("public holidays") << QByteArray("Mo-Fr 08:00-18:00; PH off");
+    }
+
+    void benchmarkInterval()
+    {
+        QFETCH(QByteArray, expr);
+        OpeningHours oh(expr);
+        oh.setRegion(QStringLiteral("DE-BE"));
+        QCOMPARE(oh.error(), OpeningHours::NoError);
+
+        const QDateTime dt({2020, 11, 7}, {18, 32});
+        QBENCHMARK {
+            oh.interval(dt);
+        }
+        QVERIFY(oh.interval(dt).isValid());
+    }
+
+    void benchmarkIterate()
+    {
+        const QDateTime begin({2020, 11, 7}, {18, 32});
+        const auto end = begin.addDays(28);
+        QBENCHMARK {
+            for (const auto &oh : m_expressions) {
+                for (auto i = oh.interval(begin); i.isValid() && i.begin() < end && !i.hasOpenEnd(); i = oh.nextInterval(i)) {
+                }
+            }
+        }
+    }
+
+    void benchmarkIntervals()
+    {
+        const QDateTime begin({2020, 11, 7}, {18, 32});
+        const auto end = begin.addDays(28);
+        QBENCHMARK {
+            for (const auto &oh : m_expressions) {
+                oh.intervals(begin, end);
+            }
+        }
+    }
+};
+
+QTEST_GUILESS_MAIN(EvaluateBenchmark)
+
+#include "evaluatebenchmark.moc"
@@ -66,6 +66,9 @@ private Q_SLOTS:
         QTest::newRow("day and time") << QByteArray("Su 20:00-22:00") << QDateTime({2020, 11, 8}, {20, 0}) << QDateTime({2020, 11, 8}, {22, 0});
         QTest::newRow("day and 24h time after") << QByteArray("Tu-Fr 12:00-12:00") << QDateTime({2020, 11, 10}, {12, 0}) << QDateTime({2020, 11, 11}, {12, 0});
         QTest::newRow("day and 24h time before") << QByteArray("Fr 19:00-19:00") << QDateTime({2020, 11, 6}, {19, 0}) << QDateTime({2020, 11, 7}, {19, 0});
+        QTest::newRow("overlapping times") << QByteArray("Mo-Fr 08:00-12:00,10:00-14:00") << QDateTime({2020, 11, 9}, {8, 0}) << QDateTime({2020, 11, 9}, {12, 0});
+        QTest::newRow("closed time range") << QByteArray("Sa 10:00-20:00, Sa 12:00-19:00 closed") << QDateTime({2020, 11, 7}, {19, 0}) << QDateTime({2020, 11, 7}, {20, 0});
+        QTest::newRow("overriding time range") << QByteArray("Mo-Sa 10:00-20:00; Sa 12:00-19:00") << QDateTime({2020, 11, 7}, {12, 0}) << QDateTime({2020, 11, 7}, {19, 0});
 
         QTest::newRow("24/7") << QByteArray("24/7") << QDateTime() << QDateTime();
 
@@ -147,6 +150,7 @@ private Q_SLOTS:
         QTest::newRow("nth day last day") << QByteArray("Su[-1]") << QDateTime({2020, 11, 29}, {0, 0}) << QDateTime({2020, 11, 30}, {0, 0});
         QTest::newRow("nth day -3") << QByteArray("Su[-3]") << QDateTime({2020, 11, 15}, {0, 0}) << QDateTime({2020, 11, 16}, {0, 0});
         QTest::newRow("nth day -5") << QByteArray("Su[-5]") << QDateTime({2021, 1, 3}, {0, 0}) << QDateTime({2021, 1, 4}, {0, 0});
+        QTest::newRow("nth day months ahead") << QByteArray("Fr[5]") << QDateTime({2021, 1, 29}, {0, 0}) << QDateTime({2021, 1, 30}, {0, 0});
         QTest::newRow("nth day 4/-3") << QByteArray("Su[4,-3]") << QDateTime({2020, 11, 15}, {0, 0}) << QDateTime({2020, 11, 16}, {0, 0});
         QTest::newRow("nth day 3/-4") << QByteArray("Su[-4,3]") << QDateTime({2020, 11, 8}, {0, 0}) << QDateTime({2020, 11, 9}, {0, 0});
         QTest::newRow("nth day range 2") << QByteArray("Su[1-2]") << QDateTime({2020, 11, 8}, {0, 0}) << QDateTime({2020, 11, 9}, {0, 0});
@@ -168,6 +172,9 @@ private Q_SLOTS:
         QTest::newRow("nth day month end") << QByteArray("Oct Su[1]-Nov Su[-4] 09:00-12:00") << QDateTime({2020, 11, 8}, {9, 0}) << QDateTime({2020, 11, 8}, {12, 0});
         QTest::newRow("nth day only end") << QByteArray("Oct 1-Nov Su[-4] 09:00-12:00") << QDateTime({2020, 11, 8}, {9, 0}) << QDateTime({2020, 11, 8}, {12, 0});
         QTest::newRow("nth day only end with weekday") << QByteArray("Oct 1-Nov Su[-4] Mo 09:00-12:00") << QDateTime({2020, 11, 9}, {9, 0}) << QDateTime({2020, 11, 9}, {12, 0});
+
+        QTest::newRow("sparse nth day") << QByteArray("Feb Mo[5]") << QDateTime({2044, 2, 29}, {0, 0}) << QDateTime({2044, 3, 1}, {0, 0});
+        QTest::newRow("sparse nth day over a century") << QByteArray("2073+ Feb Mo[5] 10:00-12:00") << QDateTime({2112, 2, 29}, {10, 0}) << QDateTime({2112, 2, 29}, {12, 0});
     }
 
     void testNext()
@@ -190,6 +197,7 @@ private Q_SLOTS:
         QCOMPARE(i.begin(), begin);
         QCOMPARE(i.end(), end);
         QCOMPARE(i.state(), Interval::Open);
+        QCOMPARE(oh.error(), OpeningHours::NoError);
     }
 
     void testNoMatch_data()
@@ -312,6 +320,19 @@ private Q_SLOTS:
         QCOMPARE(i.comment(), QLatin1String("on appointment"));
     }
 
+    void testDstTransition()
+    {
+        // the next interval is after the switch to daylight saving time
+        OpeningHours oh("Mo-Fr 08:00-18:00");
+        QCOMPARE(oh.error(), OpeningHours::NoError);
+        auto i = oh.interval(QDateTime({2021, 3, 27}, {18, 0}));
+        QCOMPARE(i.state(), Interval::Closed);
+        i = oh.nextInterval(i);
+        QCOMPARE(i.begin(), QDateTime({2021, 3, 29}, {8, 0}));
+        QCOMPARE(i.end(), QDateTime({2021, 3, 29}, {18, 0}));
+        QCOMPARE(i.state(), Interval::Open);
+    }
+
     void testLookBack()
     {
         OpeningHours oh("Oct-Mar");
@@ -9,6 +9,7 @@
 
 #include <QAbstractItemModelTester>
 #include <QDateTime>
+#include <QSignalSpy>
 #include <QTest>
 
 using namespace KOpeningHours;
@@ -42,6 +43,40 @@ private Q_SLOTS:
         }
     }
 
+    void testModelUpdate()
+    {
+        IntervalModel model;
+        QAbstractItemModelTester modelTest(&model);
+        model.setBeginDate({2020, 11, 2});
+        model.setEndDate({2020, 11, 9});
+        model.setOpeningHours(OpeningHours("Mo,We,Fr 10:00-20:00; Su 08:00-14:00"));
+        QCOMPARE(model.rowCount(), 7);
+
+        QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+        QSignalSpy changeSpy(&model, &QAbstractItemModel::dataChanged);
+        model.setOpeningHours(OpeningHours("Mo,We,Fr 10:00-20:00; Su 08:00-15:00"));
+        QCOMPARE(resetSpy.size(), 0);
+        QCOMPARE(changeSpy.size(), 1);
+        QCOMPARE(changeSpy.at(0).at(0).toModelIndex().row(), 6);
+        QCOMPARE(changeSpy.at(0).at(1).toModelIndex().row(), 6);
+        const auto intervals = model.index(6, 0).data(IntervalModel::IntervalsRole).value<std::vector<Interval>>();
+        QCOMPARE(intervals.size(), 3);
+        QCOMPARE(intervals[1].end(), QDateTime({2020, 11, 8}, {15, 0}));
+
+        model.setOpeningHours(OpeningHours("Mo-Fr 10:00-20:00; Su 08:00-15:00"));
+        QCOMPARE(resetSpy.size(), 0);
+        QCOMPARE(changeSpy.size(), 3);
+        QCOMPARE(changeSpy.at(1).at(0).toModelIndex().row(), 1);
+        QCOMPARE(changeSpy.at(2).at(0).toModelIndex().row(), 3);
+
+        model.setOpeningHours(OpeningHours("Mo-Fr 10:00-20:00; Su 08:00-15:00"));
+        QCOMPARE(changeSpy.size(), 3);
+
+        model.setOpeningHours(OpeningHours("23/7"));
+        QCOMPARE(resetSpy.size(), 1);
+        QCOMPARE(model.rowCount(), 0);
+    }
+
     void testModelOpenIntervals()
     {
         IntervalModel model;
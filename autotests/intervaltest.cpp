@@ -66,6 +66,29 @@ private Q_SLOTS:
         QCOMPARE(j < i, true);
     }
 
+    void testEquality()
+    {
+        Interval i, j;
+        QVERIFY(i == j);
+        QVERIFY(!(i != j));
+        i.setBegin(QDateTime({2020, 11, 7}, {18, 0}));
+        QVERIFY(!(i == j));
+        QVERIFY(i != j);
+        j.setBegin(QDateTime({2020, 11, 7}, {18, 0}));
+        QVERIFY(i == j);
+        QVERIFY(!(i != j));
+
+        i.setState(Interval::Open);
+        QVERIFY(i != j);
+        j.setState(Interval::Open);
+        QVERIFY(i == j);
+        i.setComment(QStringLiteral("comment"));
+        QVERIFY(i != j);
+        const auto k = i;
+        QVERIFY(k == i);
+        QVERIFY(!(k != i));
+    }
+
     void testZeroLengthOpenEndTime()
     {
         Interval i;
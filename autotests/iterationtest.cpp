@@ -131,6 +131,42 @@ private Q_SLOTS:
 #endif
         QCOMPARE(refData, b);
     }
+
+    void testIntervals_data()
+    {
+        testIterate_data();
+    }
+
+    void testIntervals()
+    {
+        QFETCH(QString, inputFile);
+
+        QFile inFile(inputFile);
+        QVERIFY(inFile.open(QFile::ReadOnly | QFile::Text));
+
+        OpeningHours oh(inFile.readLine());
+        oh.setLocation(52.5, 13.0);
+        oh.setRegion(QStringLiteral("DE-BE"));
+        oh.setTimeZone(QTimeZone("Europe/Berlin"));
+        QCOMPARE(oh.error(), OpeningHours::NoError);
+
+        const QDateTime begin({2020, 11, 7}, {18, 32, 14});
+        const auto end = begin.addDays(28);
+        std::vector<Interval> expected;
+        for (auto i = oh.interval(begin); i.isValid(); i = oh.nextInterval(i)) {
+            expected.push_back(i);
+            if (i.hasOpenEnd() || i.end() >= end) {
+                break;
+            }
+        }
+
+        const auto intervals = oh.intervals(begin, end);
+        QCOMPARE(intervals.size(), expected.size());
+        for (std::size_t i = 0; i < intervals.size(); ++i) {
+            QVERIFY(intervals[i] == expected[i]);
+        }
+        QVERIFY(oh.intervals(end, begin).empty());
+    }
 };
 
 QTEST_GUILESS_MAIN(IterationTest)
@@ -50,6 +50,39 @@ private Q_SLOTS:
         QCOMPARE(oh.error(), OpeningHours::NoError);
         QCOMPARE(oh.normalizedExpression(), osmExpr);
     }
+
+    void testJsonLdLines()
+    {
+        QFile inFile(QStringLiteral(SOURCE_DIR "/jsonlddata/records.jsonl"));
+        QVERIFY(inFile.open(QFile::ReadOnly));
+
+        const auto ohs = OpeningHours::fromJsonLdLines(&inFile);
+        QCOMPARE(ohs.size(), std::size_t(11));
+        QCOMPARE(ohs[0].error(), OpeningHours::NoError);
+        QCOMPARE(ohs[0].normalizedExpression(), QByteArray("Mo-Fr 10:00-19:00; Sa 10:00-22:00; Su 10:00-21:00"));
+        QCOMPARE(ohs[1].error(), OpeningHours::Null);
+        QCOMPARE(ohs[2].error(), OpeningHours::Null);
+        QCOMPARE(ohs[3].error(), OpeningHours::NoError);
+        QCOMPARE(ohs[3].normalizedExpression(), QByteArray("Mo 09:00-12:00 open; Th 09:00-15:00 open"));
+        QCOMPARE(ohs[4].error(), OpeningHours::Null);
+        QCOMPARE(ohs[5].error(), OpeningHours::SyntaxError);
+        QCOMPARE(ohs[6].error(), OpeningHours::NoError);
+        QCOMPARE(ohs[6].normalizedExpression(), QByteArray("Mo,We 08:00-12:00"));
+        QCOMPARE(ohs[7].error(), OpeningHours::NoError);
+        QCOMPARE(ohs[7].normalizedExpression(), QByteArray("2014 Jan 01 12:00-14:00 open"));
+        QCOMPARE(ohs[8].error(), OpeningHours::NoError);
+        QCOMPARE(ohs[8].normalizedExpression(), QByteArray("Tu 10:00-12:00"));
+        QCOMPARE(ohs[10].error(), OpeningHours::Null);
+
+        // same result as decoding the entire records
+        inFile.seek(0);
+        for (const auto &oh : ohs) {
+            const auto obj = QJsonDocument::fromJson(inFile.readLine()).object();
+            const auto expected = obj.isEmpty() ? OpeningHours() : OpeningHours::fromJsonLd(obj);
+            QCOMPARE(oh.error(), expected.error());
+            QCOMPARE(oh.normalizedExpression(), expected.normalizedExpression());
+        }
+    }
 };
 
 QTEST_GUILESS_MAIN(JsonLdTest)
@@ -0,0 +1,198 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include <KOpeningHours/OpeningHours>
+
+#include <QDirIterator>
+#include <QFile>
+#include <QTest>
+
+#include <vector>
+
+using namespace KOpeningHours;
+
+/** Parser benchmark on the expressions of the iteration test data.
+ *  This runs a second time with KOPENINGHOURS_NO_CANONICAL_PARSER set,
+ *  to compare the canonical parser fast path with the full parser.
+ */
+class ParserBenchmark : public QObject
+{
+    Q_OBJECT
+private:
+    std::vector<QByteArray> m_expressions;
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QDirIterator it(QStringLiteral(SOURCE_DIR "/data"), {QStringLiteral("*.intervals")}, QDir::Files | QDir::Readable | QDir::NoSymLinks);
+        while (it.hasNext()) {
+            QFile f(it.next());
+            QVERIFY(f.open(QFile::ReadOnly));
+            m_expressions.push_back(f.readLine().trimmed());
+        }
+        QVERIFY(!m_expressions.empty());
+    }
+
+    void benchmarkParse()
+    {
+        QBENCHMARK {
+            for (const auto &expr : m_expressions) {
+                OpeningHours oh(expr);
+            }
+        }
+
+        for (const auto &expr : m_expressions) {
+            OpeningHours oh(expr);
+            QVERIFY(oh.error() != OpeningHours::SyntaxError);
+        }
+    }
+
+    void benchmarkDeserialize()
+    {
+        std::vector<QByteArray> serialized;
+        serialized.reserve(m_expressions.size());
+        for (const auto &expr : m_expressions) {
+            serialized.push_back(OpeningHours(expr).serialize());
+        }
+
+        QBENCHMARK {
+            for (const auto &data : serialized) {
+                OpeningHours::deserialize(data);
+            }
+        }
+    }
+
+    void benchmarkNormalize()
+    {
+        std::vector<OpeningHours> parsed;
+        parsed.reserve(m_expressions.size());
+        for (const auto &expr : m_expressions) {
+            parsed.emplace_back(expr);
+        }
+
+        QBENCHMARK {
+            for (const auto &oh : parsed) {
+                oh.normalizedExpression();
+            }
+        }
+    }
+
+    void benchmarkParseAmbiguous_data()
+    {
+        QTest::addColumn<QByteArray>("expr");
+        // each of those hits at least one of the grammar conflicts the GLR parser has to split on
+        QTest::newRow("month date") << QByteArray("Dec 24 off");
+        QTest::newRow("month weekday") << QByteArray("Dec Mo-Fr 10:00-16:00");
+        QTest::newRow("month day list") << QByteArray("Dec 24, 26 off");
+        QTest::newRow("year month range") << QByteArray("2020 Jan-2021 Mar Mo-Fr 08:00-12:00");
+        QTest::newRow("weekday offset") << QByteArray("Mar Su[-1]-Oct Su[-1] 10:00-18:00");
+        QTest::newRow("holiday and weekday") << QByteArray("Mo,We PH,SH 10:00-12:00");
+        QTest::newRow("time interval") << QByteArray("10:00-16:00/01:30");
+        QTest::newRow("week interval") << QByteArray("week 1-53/2 Fr 09:00-12:00");
+    }
+
+    void benchmarkParseAmbiguous()
+    {
+        QFETCH(QByteArray, expr);
+        QBENCHMARK {
+            OpeningHours oh(expr);
+        }
+
+        OpeningHours oh(expr);
+        QVERIFY(oh.error() != OpeningHours::SyntaxError);
+    }
+
+    void benchmarkParseLarge_data()
+    {
+        QTest::addColumn<QByteArray>("expr");
+        QTest::addColumn<int>("ruleCount");
+
+        static const char *months[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+        const auto monthday = [](int i) {
+            return QByteArray(months[(i / 28) % 12]) + ' ' + QByteArray::number(i % 28 + 1).rightJustified(2, '0');
+        };
+        const auto time = [](int i) {
+            const auto minutes = i % (23 * 60);
+            const auto formatTime = [](int m) {
+                return QByteArray::number(m / 60).rightJustified(2, '0') + ':' + QByteArray::number(m % 60).rightJustified(2, '0');
+            };
+            return formatTime(minutes) + '-' + formatTime(minutes + 1);
+        };
+
+        // each size runs with 1k and 10k elements, the time per element should not grow with the expression size
+        for (int n : {1000, 10000}) {
+            QByteArray dated, additionalMonthdays, additionalTimes, monthdayList;
+            for (int i = 0; i < n; ++i) {
+                if (i > 0) {
+                    dated += "; ";
+                    additionalMonthdays += ", ";
+                    additionalTimes += ", ";
+                    monthdayList += ',';
+                }
+                dated += QByteArray::number(2001 + i / (12 * 28)) + ' ' + monthday(i) + ' ' + time(i);
+                additionalMonthdays += monthday(i);
+                additionalTimes += time(i);
+                monthdayList += (i % 28 == 0) ? monthday(i) : QByteArray::number(i % 28 + 1).rightJustified(2, '0');
+            }
+            additionalTimes.prepend("Mo-Fr ");
+
+            // separate rules that cannot be merged
+            QTest::addRow("dated rules %d", n) << dated << n;
+            // additional rules that autocorrect() merges into a single rule
+            QTest::addRow("additional monthdays %d", n) << additionalMonthdays << 1;
+            QTest::addRow("additional times %d", n) << additionalTimes << 1;
+            // a single selector list
+            QTest::addRow("monthday list %d", n) << monthdayList << 1;
+        }
+    }
+
+    void benchmarkParseLarge()
+    {
+        QFETCH(QByteArray, expr);
+        QFETCH(int, ruleCount);
+
+        QBENCHMARK {
+            OpeningHours oh(expr);
+        }
+
+        OpeningHours oh(expr);
+        QVERIFY(oh.error() != OpeningHours::SyntaxError);
+        const auto normalized = oh.normalizedExpression();
+        QCOMPARE(normalized.count(';') + normalized.count(", ") + 1, ruleCount);
+    }
+
+    void benchmarkSimplifyLarge_data()
+    {
+        QTest::addColumn<QByteArray>("expr");
+        for (int n : {1000, 10000}) {
+            // rules that simplify() merges into a single rule
+            QByteArray expr;
+            for (int i = 0; i < n; ++i) {
+                if (i > 0) {
+                    expr += "; ";
+                }
+                expr += QByteArray("MoTuWeThFrSaSu").mid((i % 7) * 2, 2) + " 08:00-12:00";
+            }
+            QTest::addRow("weekday rules %d", n) << expr;
+        }
+    }
+
+    void benchmarkSimplifyLarge()
+    {
+        QFETCH(QByteArray, expr);
+        OpeningHours oh(expr);
+        QVERIFY(oh.error() != OpeningHours::SyntaxError);
+
+        QBENCHMARK {
+            oh.simplifiedExpression();
+        }
+        QCOMPARE(oh.simplifiedExpression(), QByteArray("Mo-Su 08:00-12:00"));
+    }
+};
+
+QTEST_GUILESS_MAIN(ParserBenchmark)
+
+#include "parserbenchmark.moc"
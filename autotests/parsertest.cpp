@@ -4,12 +4,36 @@
     SPDX-License-Identifier: LGPL-2.0-or-later
 */
 
+#include <KOpeningHours/ExpressionCache>
+#include <KOpeningHours/OpeningHoursLiteral>
 #include <KOpeningHours/OpeningHours>
 
 #include <QTest>
+#include <QThread>
+
+#include <cmath>
+#include <memory>
 
 using namespace KOpeningHours;
 
+class NormalizeThread : public QThread
+{
+public:
+    explicit NormalizeThread(const OpeningHours &oh)
+        : m_oh(oh)
+    {
+    }
+    void run() override
+    {
+        result = m_oh.normalizedExpression();
+    }
+
+    QByteArray result;
+
+private:
+    const OpeningHours &m_oh;
+};
+
 class ParserTest : public QObject
 {
     Q_OBJECT
@@ -322,7 +346,9 @@ private Q_SLOTS:
         T2("月～土 　17:00～23:00", "Mo-Sa 17:00-23:00");
         T2("Mo-Fr 08:00-17:00 “Visa Applications\"", "Mo-Fr 08:00-17:00 \"Visa Applications\"");
         T2("„nach Vereinbarung“", "\"nach Vereinbarung\"");
+        T2("Mo–Fr 08:00–12:00 “x”; Sa 09:00–12:00", "Mo-Fr 08:00-12:00 \"x\"; Sa 09:00-12:00"); // Unicode folding continues after comments
         T("\"„Termine nach Vereinbarung“\"");
+        T("Mo-Fr 08:00-17:00 \"Sa\xC2\xA0" "08:00–12:00 → by appointment\""); // no Unicode folding in comments
 
         // non-English
         T2("Lundi au Vendredi 8h - 17h en continu", "Mo-Fr 08:00-17:00");
@@ -379,6 +405,10 @@ private Q_SLOTS:
 
         // Simplification of the output
         T3("Mo 08:00-13:00; Tu 08:00-13:00", nullptr, "Mo,Tu 08:00-13:00");
+        T3("Mo 08:00-12:00; Sa 10:00-14:00; Tu 08:00-12:00", nullptr, "Mo,Tu 08:00-12:00; Sa 10:00-14:00");
+        T("Mo 08:00-12:00; Mo-Sa 10:00-14:00; Tu 08:00-12:00"); // does not simplify, Mo-Sa overrides Tu
+        T("Mo 08:00-12:00; PH off; Tu 08:00-12:00"); // does not simplify, PH can be on a Tuesday
+        T("Mo 20:00-02:00; Th 10:00-14:00; We 20:00-02:00"); // does not simplify, We 20:00-02:00 reaches into Th
         T3("Mo-Th 08:00-13:00; Sa[1],Su[-1] 08:00-13:00", "Mo-Th 08:00-13:00; Sa[1],Su[-1] 08:00-13:00", "Mo-Th,Sa[1],Su[-1] 08:00-13:00");
         T("easter +1 day 08:00-13:00; Tu,Sa,Su 08:00-13:00"); // does not simplify
         T3("Mo-Sa 12:00-15:00, Mo-Sa 18:00-24:00", "Mo-Sa 12:00-15:00, Mo-Sa 18:00-24:00", "Mo-Sa 12:00-15:00,18:00-24:00");
@@ -416,10 +446,31 @@ private Q_SLOTS:
         QFETCH(QByteArray, expectedSimplifiedOutput);
         OpeningHours oh(input);
         QVERIFY(oh.error() != OpeningHours::SyntaxError);
+        QCOMPARE(OpeningHours::check(input), oh.error());
         QCOMPARE(oh.normalizedExpression(), expectedOutput);
+        QCOMPARE(OpeningHours::deferred(input).normalizedExpression(), expectedOutput);
         QCOMPARE(oh.simplifiedExpression(), expectedSimplifiedOutput);
         // verify that simplifiedExpression() doesn't alter `oh`
         QCOMPARE(oh.normalizedExpression(), expectedOutput);
+        // binary serialization restores the same expression
+        const auto deserialized = OpeningHours::deserialize(oh.serialize());
+        QCOMPARE(deserialized.error(), oh.error());
+        QCOMPARE(deserialized.normalizedExpression(), expectedOutput);
+        QCOMPARE(deserialized.simplifiedExpression(), expectedSimplifiedOutput);
+        // in-place simplification gives the same result
+        OpeningHours simplified(input);
+        simplified.simplify();
+        QCOMPARE(simplified.normalizedExpression(), expectedSimplifiedOutput);
+        QCOMPARE(simplified.error(), oh.error());
+
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+        // UTF-16 input gives the same result
+        const auto utf16Input = QString::fromUtf8(input);
+        OpeningHours utf16Oh(utf16Input);
+        QCOMPARE(utf16Oh.error(), oh.error());
+        QCOMPARE(utf16Oh.normalizedExpression(), expectedOutput);
+        QCOMPARE(OpeningHours::check(utf16Input), oh.error());
+#endif
 
         // verify the expressions we generate are parsed correctly as well
         OpeningHours oh2(oh.normalizedExpression());
@@ -484,6 +535,8 @@ private Q_SLOTS:
         QFETCH(OpeningHours::Error, error);
         OpeningHours oh(input);
         QCOMPARE(oh.error(), error);
+        QCOMPARE(OpeningHours::check(input), error);
+        QCOMPARE(OpeningHours::deferred(input).error(), error);
     }
 
     void testValidation_data()
@@ -505,6 +558,8 @@ private Q_SLOTS:
         QTest::newRow("month timepoint") << QByteArray("Dec 08:00") << OpeningHours::IncompatibleMode;
         QTest::newRow("wide range selector comment") << QByteArray("\"Außerhalb der Semesterferien\": Mo-Fr 08:00-22:00; Sa-Su 10:00-20:00; \"Innerhalb der Semesterferien\": Mo-Fr 08:00-18:00; Sa-Su 10:00-16:00;") << OpeningHours::UnsupportedFeature;
 
+        QTest::newRow("24/7 in interval mode") << QByteArray("Mo-Fr 08:00-18:00; Sa, 24/7") << OpeningHours::NoError;
+        QTest::newRow("24/7 additional rule") << QByteArray("Sa, 24/7") << OpeningHours::NoError;
         QTest::newRow("empty") << QByteArray("") << OpeningHours::Null;
         QTest::newRow("empty comment") << QByteArray("\"\"") << OpeningHours::Null;
     }
@@ -516,9 +571,186 @@ private Q_SLOTS:
 
         OpeningHours oh(expression);
         QCOMPARE(oh.error(), error);
+        QCOMPARE(OpeningHours::check(expression), error);
+        QCOMPARE(OpeningHours::check(expression, OpeningHours::PointInTimeMode), OpeningHours(expression, OpeningHours::PointInTimeMode).error());
         (void)oh.normalizedExpression(); // don't crash
         (void)oh.simplifiedExpression(); // don't crash
     }
+
+    void testBatch()
+    {
+        const std::vector<QByteArray> samples = {
+            "Mo-Fr 08:00-18:00",
+            "Mo-Fr 08:00-12:00,13:00-17:30; Sa 08:00-12:00; PH off",
+            "Mo-Fr 09:00-17:00 Sa 09:00-14:00",
+            "sunrise-sunset",
+            "23/7",
+            "",
+        };
+        std::vector<QByteArray> expressions;
+        for (int i = 0; i < 1000; ++i) {
+            expressions.push_back(samples[i % samples.size()]);
+        }
+
+        const auto result = OpeningHours::parseBatch(expressions);
+        QCOMPARE(result.size(), expressions.size());
+        for (std::size_t i = 0; i < expressions.size(); ++i) {
+            OpeningHours oh(expressions[i]);
+            QCOMPARE(result[i].error(), oh.error());
+            QCOMPARE(result[i].normalizedExpression(), oh.normalizedExpression());
+        }
+
+        QVERIFY(OpeningHours::parseBatch({}).empty());
+    }
+
+    void testDeferred()
+    {
+        auto oh = OpeningHours::deferred("Mo-Fr sunrise-sunset");
+        const auto copy = oh;
+        // settings before parsing are considered
+        oh.setLocation(52.5f, 13.4f);
+        QCOMPARE(copy.error(), OpeningHours::NoError);
+        oh.setLatitude(NAN);
+        QCOMPARE(oh.error(), OpeningHours::MissingLocation);
+
+        // concurrent first use
+        const auto shared = OpeningHours::deferred("Mo-Fr 08:00-18:00; Sa 10:00-12:00");
+        std::vector<std::unique_ptr<NormalizeThread>> threads;
+        for (int i = 0; i < 8; ++i) {
+            threads.push_back(std::make_unique<NormalizeThread>(shared));
+        }
+        for (const auto &thread : threads) {
+            thread->start();
+        }
+        for (const auto &thread : threads) {
+            QVERIFY(thread->wait());
+            QCOMPARE(thread->result, QByteArray("Mo-Fr 08:00-18:00; Sa 10:00-12:00"));
+        }
+
+        // setting an expression replaces a not yet parsed one
+        auto replaced = OpeningHours::deferred("Mo 10:00-12:00");
+        replaced.setExpression(QByteArray("Tu 10:00-12:00"));
+        QCOMPARE(replaced.normalizedExpression(), QByteArray("Tu 10:00-12:00"));
+
+        QCOMPARE(OpeningHours::deferred({}).error(), OpeningHours::Null);
+    }
+
+    void testSerialize()
+    {
+        QVERIFY(OpeningHours().serialize().isEmpty());
+        QVERIFY(OpeningHours("23/7").serialize().isEmpty());
+        QCOMPARE(OpeningHours::deserialize(QByteArray()).error(), OpeningHours::Null);
+        QCOMPARE(OpeningHours::deserialize(QByteArray("Mo-Fr 08:00-18:00")).error(), OpeningHours::SyntaxError);
+
+        // modes are retained and validated against
+        OpeningHours pointInTime("Mo-Fr 10:00,16:00", OpeningHours::PointInTimeMode);
+        const auto data = pointInTime.serialize();
+        QVERIFY(!data.isEmpty());
+        const auto restored = OpeningHours::deserialize(data);
+        QCOMPARE(restored.error(), pointInTime.error());
+        QCOMPARE(restored.normalizedExpression(), pointInTime.normalizedExpression());
+
+        // truncated or extended data is rejected
+        for (int i = 1; i < data.size(); ++i) {
+            QCOMPARE(OpeningHours::deserialize(data.constData(), i).error(), OpeningHours::SyntaxError);
+        }
+        QCOMPARE(OpeningHours::deserialize(data + 'x').error(), OpeningHours::SyntaxError);
+    }
+
+    void testLiteral()
+    {
+        static_assert(Literal::isValid("Mo-Fr 08:00-18:00"));
+        static_assert(Literal::isValid("Mo-Fr 08:00-12:00,13:00-18:00; Sa 10:00-14:00; PH off"));
+        static_assert(Literal::isValid("Mo,We 10:00-12:00, Sa 10:00-11:00 closed"));
+        static_assert(Literal::isValid("24/7"));
+        static_assert(Literal::isValid("PH off"));
+        static_assert(Literal::isValid("Mo 20:00-26:00; unknown"));
+        static_assert(!Literal::isValid(""));
+        static_assert(!Literal::isValid("Mo-Fr 08:00-18:00;"));
+        static_assert(!Literal::isValid("Mo-Fr 08:00-24:60"));
+        static_assert(!Literal::isValid("Mo-Fr 8:00-18:00"));
+        static_assert(!Literal::isValid("Dec 24 off")); // valid, but not supported for literals
+        static_assert(!Literal::isValid("SH off"));
+        static_assert(!Literal::isValid("Mo 10:00+"));
+        static_assert(!Literal::isValid("Mo[1] 10:00-12:00"));
+        static_assert(!Literal::isValid("Mo-Fr 08:00-18:00 \"by appointment\""));
+
+        auto oh = KOPENINGHOURS_LITERAL("Mo-Fr 08:00-18:00; PH off");
+        QCOMPARE(oh.normalizedExpression(), QByteArray("Mo-Fr 08:00-18:00; PH off"));
+        QCOMPARE(oh.simplifiedExpression(), QByteArray("Mo-Fr 08:00-18:00; PH off"));
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+        // settings are not shared between instances of the same literal
+        const auto makeLiteral = []() { return KOPENINGHOURS_LITERAL("Mo-Fr 08:00-18:00; PH off"); };
+        auto oh1 = makeLiteral();
+        auto oh2 = makeLiteral();
+        QCOMPARE(oh1.error(), OpeningHours::MissingRegion);
+        oh1.setRegion(QStringLiteral("DE"));
+        QCOMPARE(oh1.error(), OpeningHours::NoError);
+        QCOMPARE(oh2.error(), OpeningHours::MissingRegion);
+#endif
+    }
+
+    void testExpressionCache()
+    {
+        ExpressionCache cache;
+        QCOMPARE(cache.size(), 0);
+
+        auto oh1 = cache.openingHours("Mo-Fr 08:00-18:00; PH off");
+        QCOMPARE(cache.misses(), quint64(1));
+        QCOMPARE(cache.hits(), quint64(0));
+        auto oh2 = cache.openingHours("Mo-Fr 08:00-18:00; PH off");
+        QCOMPARE(cache.misses(), quint64(1));
+        QCOMPARE(cache.hits(), quint64(1));
+        QCOMPARE(cache.size(), 1);
+        QCOMPARE(oh2.normalizedExpression(), oh1.normalizedExpression());
+        QCOMPARE(oh2.error(), oh1.error());
+
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+        // settings are not shared between cached instances
+        QCOMPARE(oh1.error(), OpeningHours::MissingRegion);
+        oh1.setRegion(QStringLiteral("DE"));
+        QCOMPARE(oh1.error(), OpeningHours::NoError);
+        QCOMPARE(oh2.error(), OpeningHours::MissingRegion);
+        QCOMPARE(cache.openingHours("Mo-Fr 08:00-18:00; PH off").error(), OpeningHours::MissingRegion);
+#endif
+
+        // modes are part of the cache key
+        QCOMPARE(cache.openingHours("10:00").error(), OpeningHours::IncompatibleMode);
+        QCOMPARE(cache.openingHours("10:00", OpeningHours::PointInTimeMode).error(), OpeningHours::UnsupportedFeature);
+        QCOMPARE(cache.size(), 3);
+
+        QCOMPARE(cache.openingHours("23/7").error(), OpeningHours::SyntaxError);
+        QCOMPARE(cache.openingHours("23/7").error(), OpeningHours::SyntaxError);
+        QCOMPARE(cache.openingHours("").error(), OpeningHours::Null);
+
+        // simplifying a cached instance does not affect the cache
+        auto oh3 = cache.openingHours("Mo 08:00-13:00; Tu 08:00-13:00");
+        oh3.simplify();
+        QCOMPARE(oh3.normalizedExpression(), QByteArray("Mo,Tu 08:00-13:00"));
+        QCOMPARE(cache.openingHours("Mo 08:00-13:00; Tu 08:00-13:00").normalizedExpression(), QByteArray("Mo 08:00-13:00; Tu 08:00-13:00"));
+
+        cache.clear();
+        QCOMPARE(cache.size(), 0);
+        QCOMPARE(cache.hits(), quint64(0));
+        QCOMPARE(cache.misses(), quint64(0));
+        // instances keep the rules they share with discarded entries alive
+        QCOMPARE(oh1.normalizedExpression(), QByteArray("Mo-Fr 08:00-18:00; PH off"));
+        QCOMPARE(oh2.normalizedExpression(), QByteArray("Mo-Fr 08:00-18:00; PH off"));
+
+        // least recently used entries are discarded beyond the maximum size
+        QCOMPARE(cache.maximumSize(), 10000);
+        cache.setMaximumSize(2);
+        cache.openingHours("Mo 10:00-12:00");
+        cache.openingHours("Tu 10:00-12:00");
+        cache.openingHours("Mo 10:00-12:00");
+        cache.openingHours("We 10:00-12:00");
+        QCOMPARE(cache.size(), 2);
+        QCOMPARE(cache.openingHours("Mo 10:00-12:00").error(), OpeningHours::NoError);
+        QCOMPARE(cache.hits(), quint64(2));
+        cache.openingHours("Tu 10:00-12:00");
+        QCOMPARE(cache.misses(), quint64(4));
+        QCOMPARE(cache.size(), 2);
+    }
 };
 
 QTEST_GUILESS_MAIN(ParserTest)
@@ -0,0 +1,105 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "arena_p.h"
+
+#include <algorithm>
+#include <new>
+
+using namespace KOpeningHours;
+
+namespace {
+
+// the first block of an arena is sized based on the expression, as a rough estimate of how
+// much node memory that needs, later blocks double in size up to the maximum
+enum : std::size_t {
+    BytesPerExpressionByte = 16,
+    MinimumBlockSize = 256,
+    MaximumBlockSize = 16384,
+};
+
+/** Placed in front of every node, to tell nodes from an arena apart from individually allocated ones. */
+struct alignas(alignof(std::max_align_t)) NodeHeader {
+    bool inArena;
+};
+
+constexpr std::size_t alignedSize(std::size_t size)
+{
+    return (size + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+}
+
+thread_local Arena *t_currentArena = nullptr;
+
+}
+
+struct Arena::Block {
+    Block *previous;
+};
+
+Arena::Arena(std::size_t expressionSize)
+    : m_nextBlockSize(std::clamp<std::size_t>(expressionSize * BytesPerExpressionByte, MinimumBlockSize, MaximumBlockSize))
+{
+}
+
+Arena::~Arena()
+{
+    while (m_block) {
+        auto previous = m_block->previous;
+        ::operator delete(m_block);
+        m_block = previous;
+    }
+}
+
+void *Arena::allocate(std::size_t size)
+{
+    constexpr auto BlockHeaderSize = alignedSize(sizeof(Block));
+    if (m_used + size > m_capacity) {
+        const auto capacity = std::max(m_nextBlockSize, size);
+        m_block = new (::operator new(BlockHeaderSize + capacity)) Block{ m_block };
+        m_used = 0;
+        m_capacity = capacity;
+        m_nextBlockSize = std::min<std::size_t>(m_nextBlockSize * 2, MaximumBlockSize);
+    }
+
+    auto ptr = reinterpret_cast<char*>(m_block) + BlockHeaderSize + m_used;
+    m_used += size;
+    return ptr;
+}
+
+ArenaScope::ArenaScope(Arena *arena)
+    : m_previous(t_currentArena)
+{
+    t_currentArena = arena;
+}
+
+ArenaScope::~ArenaScope()
+{
+    t_currentArena = m_previous;
+}
+
+void *ArenaAllocated::operator new(std::size_t size)
+{
+    const auto allocSize = sizeof(NodeHeader) + alignedSize(size);
+    NodeHeader *header = nullptr;
+    if (t_currentArena) {
+        header = new (t_currentArena->allocate(allocSize)) NodeHeader{ true };
+    } else {
+        header = new (::operator new(allocSize)) NodeHeader{ false };
+    }
+    return header + 1;
+}
+
+void ArenaAllocated::operator delete(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    auto header = static_cast<NodeHeader*>(ptr) - 1;
+    if (!header->inArena) {
+        ::operator delete(header);
+    }
+}
@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_ARENA_P_H
+#define KOPENINGHOURS_ARENA_P_H
+
+#include <cstddef>
+
+namespace KOpeningHours {
+
+/** Memory for the rule and selector nodes of one expression.
+ *  Parsing a single expression creates dozens of tiny nodes, allocating them individually
+ *  is a significant part of the parsing cost. Instead, nodes created while an arena is
+ *  active (see ArenaScope) are placed consecutively in memory blocks owned by that arena,
+ *  and all of those are released in one go when the arena is destroyed.
+ *
+ *  An arena therefore has to outlive all nodes allocated from it. OpeningHoursPrivate
+ *  keeps it next to its rules, and so does anything else sharing those rules.
+ *  Allocating is not thread-safe, releasing is done only once.
+ */
+class Arena
+{
+public:
+    /** Creates an empty arena, whose first block will be suitable for an expression of @p expressionSize bytes. */
+    explicit Arena(std::size_t expressionSize);
+    ~Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /** Returns @p size bytes of memory suitably aligned for any node.
+     *  @p size has to be a multiple of alignof(std::max_align_t).
+     */
+    void *allocate(std::size_t size);
+
+private:
+    struct Block;
+    Block *m_block = nullptr; // current block, older ones are linked from that
+    std::size_t m_used = 0;
+    std::size_t m_capacity = 0;
+    std::size_t m_nextBlockSize;
+};
+
+/** Makes @p arena the one nodes are allocated from in the current thread, for as long as this exists.
+ *  Nodes created while no arena is active are allocated individually.
+ */
+class ArenaScope
+{
+public:
+    explicit ArenaScope(Arena *arena);
+    ~ArenaScope();
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    Arena *m_previous;
+};
+
+/** Base class for rule and selector nodes, allocating those from the active Arena.
+ *  Ownership is unaffected by this, nodes are still created with new and destroyed with delete.
+ *  Deleting a node from an arena only runs its destructor though, its memory is released
+ *  along with the arena.
+ */
+class ArenaAllocated
+{
+public:
+    static void *operator new(std::size_t size);
+    static void operator delete(void *ptr);
+};
+
+}
+
+#endif // KOPENINGHOURS_ARENA_P_H
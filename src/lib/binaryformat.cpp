@@ -0,0 +1,418 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "binaryformat_p.h"
+#include "openinghours_p.h"
+
+#include <cstring>
+#include <limits>
+
+using namespace KOpeningHours;
+
+namespace {
+static constexpr const char s_magic[] = { 'K', 'O', 'H' };
+// increment whenever the format changes in any way
+static constexpr uint8_t s_version = 1;
+// and-combined weekday selectors nest, but in practice never deeper than one level
+static constexpr int MaximumNestingDepth = 8;
+
+enum RuleFlags : uint8_t {
+    Seen_24_7 = 1,
+    ColonAfterWideRangeSelector = 2,
+};
+
+enum TimespanFlags : uint8_t {
+    OpenEnd = 1,
+    PointInTime = 2,
+};
+
+class Writer
+{
+public:
+    explicit Writer(QByteArray &out)
+        : m_out(out)
+    {
+    }
+
+    void writeUInt(quint64 value)
+    {
+        while (value >= 0x80) {
+            m_out += char((value & 0x7f) | 0x80);
+            value >>= 7;
+        }
+        m_out += char(value);
+    }
+
+    void writeInt(qint64 value)
+    {
+        writeUInt((quint64(value) << 1) ^ quint64(value >> 63));
+    }
+
+    void writeBytes(const QByteArray &data)
+    {
+        writeUInt(data.size());
+        m_out += data;
+    }
+
+    template <typename T, typename WriteFunc>
+    void writeList(const std::unique_ptr<T> &first, WriteFunc writeElement)
+    {
+        quint64 count = 0;
+        for (auto s = first.get(); s; s = s->next.get()) {
+            ++count;
+        }
+        writeUInt(count);
+        for (auto s = first.get(); s; s = s->next.get()) {
+            writeElement(*s);
+        }
+    }
+
+    template <typename T, typename WriteFunc>
+    void writeList(const std::vector<T> &selectors, WriteFunc writeElement)
+    {
+        writeUInt(selectors.size());
+        for (const auto &s : selectors) {
+            writeElement(s);
+        }
+    }
+
+    void writeTime(Time time)
+    {
+        writeUInt(time.event);
+        writeInt(time.hour);
+        writeInt(time.minute);
+    }
+
+    void writeDate(const Date &date)
+    {
+        writeInt(date.year);
+        writeUInt(date.month);
+        writeUInt(date.day);
+        writeUInt(date.variableDate);
+        writeInt(date.offset.dayOffset);
+        writeUInt(date.offset.weekday);
+        writeInt(date.offset.nthWeekday);
+    }
+
+    void writeWeekdayRanges(const std::unique_ptr<WeekdayRange> &first)
+    {
+        writeList(first, [this](const WeekdayRange &w) {
+            writeUInt(w.beginDay);
+            writeUInt(w.endDay);
+            writeInt(w.offset);
+            writeUInt(w.holiday);
+            if (w.nthSequence) {
+                writeUInt(w.nthSequence->sequence.size());
+                for (const auto &entry : w.nthSequence->sequence) {
+                    writeInt(entry.begin);
+                    writeInt(entry.end);
+                }
+            } else {
+                writeUInt(0);
+            }
+            writeWeekdayRanges(w.lhsAndSelector);
+            writeWeekdayRanges(w.rhsAndSelector);
+        });
+    }
+
+    void writeRule(const Rule &rule)
+    {
+        writeUInt(rule.m_ruleType);
+        writeUInt(rule.hasImplicitState() ? Interval::Invalid : rule.state());
+        writeUInt(rule.m_stateFlags);
+        writeUInt((rule.m_seen_24_7 ? Seen_24_7 : 0) | (rule.m_colonAfterWideRangeSelector ? ColonAfterWideRangeSelector : 0));
+        writeBytes(rule.m_comment.toUtf8());
+        writeBytes(rule.m_wideRangeSelectorComment);
+
+        writeList(rule.m_yearSelectors, [this](const YearRange &y) {
+            writeInt(y.begin);
+            writeInt(y.end);
+            writeInt(y.interval);
+        });
+        writeList(rule.m_monthdaySelectors, [this](const MonthdayRange &m) {
+            writeDate(m.begin);
+            writeDate(m.end);
+        });
+        writeList(rule.m_weekSelectors, [this](const Week &w) {
+            writeUInt(w.beginWeek);
+            writeUInt(w.endWeek);
+            writeUInt(w.interval);
+        });
+        writeWeekdayRanges(rule.m_weekdaySelector);
+        writeList(rule.m_timeSelectors, [this](const Timespan &t) {
+            writeTime(t.begin);
+            writeTime(t.end);
+            writeInt(t.interval);
+            writeUInt((t.openEnd ? OpenEnd : 0) | (t.pointInTime ? PointInTime : 0));
+        });
+    }
+
+private:
+    QByteArray &m_out;
+};
+
+/** Reads the binary format.
+ *  Any invalid or out of range input marks the reader as failed, after which all read
+ *  methods return default values. Values used as array indexes or divisors elsewhere are
+ *  range checked here, so that malformed input can't cause invalid memory accesses later.
+ */
+class Reader
+{
+public:
+    explicit Reader(const char *data, std::size_t size)
+        : m_it(data)
+        , m_end(data + size)
+    {
+    }
+
+    bool isValid() const { return m_valid; }
+    bool atEnd() const { return m_it == m_end; }
+    void fail() { m_valid = false; }
+
+    bool readMagic()
+    {
+        if (std::size_t(m_end - m_it) < sizeof(s_magic) + 1 || std::memcmp(m_it, s_magic, sizeof(s_magic)) != 0 || m_it[sizeof(s_magic)] != s_version) {
+            fail();
+            return false;
+        }
+        m_it += sizeof(s_magic) + 1;
+        return true;
+    }
+
+    quint64 readUInt()
+    {
+        quint64 value = 0;
+        for (int shift = 0; m_valid && shift < 64; shift += 7) {
+            if (m_it == m_end) {
+                break;
+            }
+            const auto b = static_cast<uint8_t>(*m_it++);
+            value |= quint64(b & 0x7f) << shift;
+            if ((b & 0x80) == 0) {
+                return value;
+            }
+        }
+        fail();
+        return 0;
+    }
+
+    qint64 readInt()
+    {
+        const auto value = readUInt();
+        return qint64(value >> 1) ^ -qint64(value & 1);
+    }
+
+    /** Read an unsigned value in the range [0, @p max]. */
+    quint64 readUInt(quint64 max)
+    {
+        const auto value = readUInt();
+        if (value > max) {
+            fail();
+            return 0;
+        }
+        return value;
+    }
+
+    /** Read a signed value in the range [@p min, @p max]. */
+    qint64 readInt(qint64 min, qint64 max)
+    {
+        const auto value = readInt();
+        if (value < min || value > max) {
+            fail();
+            return 0;
+        }
+        return value;
+    }
+
+    int readInt32()
+    {
+        return readInt(std::numeric_limits<int>::min(), std::numeric_limits<int>::max());
+    }
+
+    /** Element count of a string or list, every element takes at least one byte. */
+    std::size_t readCount()
+    {
+        const auto count = readUInt();
+        if (count > quint64(m_end - m_it)) {
+            fail();
+            return 0;
+        }
+        return count;
+    }
+
+    QByteArray readBytes()
+    {
+        const auto size = readCount();
+        if (!m_valid) {
+            return {};
+        }
+        QByteArray data(m_it, size);
+        m_it += size;
+        return data;
+    }
+
+    template <typename T, typename ReadFunc>
+    std::unique_ptr<T> readList(ReadFunc readElement)
+    {
+        std::unique_ptr<T> first;
+        auto tail = &first;
+        const auto count = readCount();
+        for (std::size_t i = 0; i < count && m_valid; ++i) {
+            tail->reset(new T);
+            readElement(**tail);
+            tail = &(*tail)->next;
+        }
+        return first;
+    }
+
+    template <typename T, typename ReadFunc>
+    std::vector<T> readVector(ReadFunc readElement)
+    {
+        std::vector<T> selectors;
+        const auto count = readCount();
+        selectors.reserve(count);
+        for (std::size_t i = 0; i < count && m_valid; ++i) {
+            selectors.emplace_back();
+            readElement(selectors.back());
+        }
+        return selectors;
+    }
+
+    Time readTime()
+    {
+        Time time;
+        time.event = static_cast<Time::Event>(readUInt(Time::Dusk));
+        time.hour = readInt32();
+        time.minute = readInt32();
+        return time;
+    }
+
+    Date readDate()
+    {
+        Date date;
+        date.year = readInt32();
+        date.month = readUInt(12);
+        date.day = readUInt(31);
+        date.variableDate = static_cast<Date::VariableDate>(readUInt(Date::Easter));
+        date.offset.dayOffset = readInt(std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+        date.offset.weekday = readUInt(7);
+        date.offset.nthWeekday = readInt(std::numeric_limits<int8_t>::min(), std::numeric_limits<int8_t>::max());
+        return date;
+    }
+
+    std::unique_ptr<WeekdayRange> readWeekdayRanges(int depth)
+    {
+        if (depth > MaximumNestingDepth) {
+            fail();
+            return {};
+        }
+        return readList<WeekdayRange>([this, depth](WeekdayRange &w) {
+            w.beginDay = readUInt(7);
+            w.endDay = readUInt(7);
+            w.offset = readInt(std::numeric_limits<int16_t>::min(), std::numeric_limits<int16_t>::max());
+            w.holiday = static_cast<WeekdayRange::Holiday>(readUInt(WeekdayRange::SchoolHoliday));
+            const auto nthCount = readCount();
+            if (nthCount > 0 && m_valid) {
+                w.nthSequence.reset(new NthSequence);
+                for (std::size_t i = 0; i < nthCount && m_valid; ++i) {
+                    NthEntry entry;
+                    entry.begin = readInt32();
+                    entry.end = readInt32();
+                    w.nthSequence->add(entry);
+                }
+            }
+            w.lhsAndSelector = readWeekdayRanges(depth + 1);
+            w.rhsAndSelector = readWeekdayRanges(depth + 1);
+        });
+    }
+
+    std::unique_ptr<Rule> readRule()
+    {
+        std::unique_ptr<Rule> rule(new Rule);
+        rule->m_ruleType = static_cast<Rule::Type>(readUInt(Rule::FallbackRule));
+        const auto state = readUInt(Interval::Unknown);
+        if (state != Interval::Invalid) {
+            rule->setState(static_cast<State>(state));
+        }
+        rule->m_stateFlags = static_cast<Rule::StateFlags>(readUInt(Rule::Off));
+        const auto flags = readUInt(Seen_24_7 | ColonAfterWideRangeSelector);
+        rule->m_seen_24_7 = flags & Seen_24_7;
+        rule->m_colonAfterWideRangeSelector = flags & ColonAfterWideRangeSelector;
+        const auto comment = readBytes();
+        rule->m_comment = QString::fromUtf8(comment.constData(), comment.size());
+        rule->m_wideRangeSelectorComment = readBytes();
+
+        rule->m_yearSelectors = readVector<YearRange>([this](YearRange &y) {
+            y.begin = readInt32();
+            y.end = readInt32();
+            y.interval = readInt(1, std::numeric_limits<int>::max());
+        });
+        rule->m_monthdaySelectors = readVector<MonthdayRange>([this](MonthdayRange &m) {
+            m.begin = readDate();
+            m.end = readDate();
+        });
+        rule->m_weekSelectors = readVector<Week>([this](Week &w) {
+            w.beginWeek = readUInt(53);
+            w.endWeek = readUInt(53);
+            w.interval = readInt(1, std::numeric_limits<uint8_t>::max());
+        });
+        rule->m_weekdaySelector = readWeekdayRanges(0);
+        rule->m_timeSelectors = readVector<Timespan>([this](Timespan &t) {
+            t.begin = readTime();
+            t.end = readTime();
+            t.interval = readInt(0, std::numeric_limits<int>::max());
+            const auto flags = readUInt(OpenEnd | PointInTime);
+            t.openEnd = flags & OpenEnd;
+            t.pointInTime = flags & PointInTime;
+        });
+        return rule;
+    }
+
+private:
+    const char *m_it;
+    const char *m_end;
+    bool m_valid = true;
+};
+}
+
+void BinaryFormat::write(const OpeningHoursPrivate *d, QByteArray &out)
+{
+    out.append(s_magic, sizeof(s_magic));
+    out += char(s_version);
+
+    Writer writer(out);
+    writer.writeUInt(static_cast<int>(d->m_modes));
+    writer.writeUInt(d->m_rules.size());
+    for (const auto &rule : d->m_rules) {
+        writer.writeRule(*rule);
+    }
+}
+
+bool BinaryFormat::read(const char *data, std::size_t size, OpeningHoursPrivate *d)
+{
+    Reader reader(data, size);
+    if (!reader.readMagic()) {
+        return false;
+    }
+
+    const auto modes = OpeningHours::Modes(QFlag(int(reader.readUInt(OpeningHours::IntervalMode | OpeningHours::PointInTimeMode))));
+    const auto ruleCount = reader.readCount();
+    auto arena = std::make_shared<Arena>(size);
+    ArenaScope arenaScope(arena.get());
+    std::vector<std::shared_ptr<Rule>> rules;
+    rules.reserve(ruleCount);
+    for (std::size_t i = 0; i < ruleCount && reader.isValid(); ++i) {
+        rules.push_back(reader.readRule());
+    }
+    if (!reader.isValid() || !reader.atEnd()) {
+        return false;
+    }
+
+    d->m_modes = modes;
+    d->m_rules = std::move(rules);
+    d->m_arena = std::move(arena);
+    return true;
+}
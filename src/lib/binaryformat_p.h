@@ -0,0 +1,40 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_BINARYFORMAT_P_H
+#define KOPENINGHOURS_BINARYFORMAT_P_H
+
+#include <QByteArray>
+
+#include <cstddef>
+
+namespace KOpeningHours {
+
+class OpeningHoursPrivate;
+
+/** Compact binary representation of parsed rules, see OpeningHours::serialize().
+ *
+ *  The format starts with a magic number and a format version, followed by the modes
+ *  and the rules. Integers are stored as variable length quantities, with signed values
+ *  zig-zag encoded. Strings and selector lists are stored as their size followed by their
+ *  content. There are no pointers or offsets, so the data doesn't depend on its location
+ *  in memory.
+ */
+namespace BinaryFormat
+{
+    /** Append the binary representation of the modes and rules of @p d to @p out. */
+    void write(const OpeningHoursPrivate *d, QByteArray &out);
+
+    /** Read modes and rules from @p size bytes at @p data into @p d.
+     *  @returns @c false if @p data isn't a valid binary representation of the current
+     *  format version, @p d remains unchanged in that case.
+     */
+    bool read(const char *data, std::size_t size, OpeningHoursPrivate *d);
+}
+
+}
+
+#endif // KOPENINGHOURS_BINARYFORMAT_P_H
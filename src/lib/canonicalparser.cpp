@@ -0,0 +1,249 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "canonicalparser_p.h"
+#include "openinghours_p.h"
+
+#include <cstring>
+
+using namespace KOpeningHours;
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+CanonicalParser::CanonicalParser(const char *data, std::size_t size)
+    : m_it(data)
+    , m_end(data + size)
+{
+}
+
+bool CanonicalParser::parse(OpeningHoursPrivate *context)
+{
+    std::vector<std::unique_ptr<Rule>> rules;
+    m_ruleType = Rule::NormalRule;
+    m_capabilities = Capability::None;
+    for (;;) {
+        std::unique_ptr<Rule> rule(context ? new Rule : nullptr);
+        if (!parseRule(rule.get())) {
+            return false;
+        }
+        if (rule) {
+            rule->m_ruleType = m_ruleType;
+            rules.push_back(std::move(rule));
+        }
+
+        if (m_it == m_end) {
+            break;
+        }
+        if (consume(", ")) {
+            m_ruleType = Rule::AdditionalRule;
+        } else if (consume("; ") || consume(";")) {
+            m_ruleType = Rule::NormalRule;
+        } else {
+            return false;
+        }
+        // trailing separators are handled by the full parser
+        if (m_it == m_end) {
+            return false;
+        }
+    }
+
+    for (auto &rule : rules) {
+        context->addRule(rule.release());
+    }
+    return true;
+}
+
+int CanonicalParser::capabilities() const
+{
+    return m_capabilities;
+}
+
+bool CanonicalParser::parseRule(Rule *rule)
+{
+    bool needsStateSeparator = false;
+    if (consume("24/7")) {
+        // autocorrect() might turn this into a time selector, which changes the required capabilities
+        if (!rule && m_ruleType == Rule::AdditionalRule) {
+            return false;
+        }
+        if (rule) {
+            rule->m_seen_24_7 = true;
+        }
+        needsStateSeparator = true;
+    } else {
+        if (m_it != m_end && std::strchr("MTWFSP", *m_it)) {
+            if (!parseWeekdaySelector(rule ? &rule->m_weekdaySelector : nullptr)) {
+                return false;
+            }
+            if (atRuleEnd()) {
+                return true;
+            }
+            if (!consume(" ")) {
+                return false;
+            }
+        }
+        if (m_it != m_end && isDigit(*m_it)) {
+            if (!parseTimeSelector(rule ? &rule->m_timeSelectors : nullptr)) {
+                return false;
+            }
+            needsStateSeparator = true;
+        }
+    }
+
+    if (needsStateSeparator) {
+        if (atRuleEnd()) {
+            return true;
+        }
+        if (!consume(" ")) {
+            return false;
+        }
+    }
+
+    State state;
+    if (!parseState(state) || !atRuleEnd()) {
+        return false;
+    }
+    if (rule) {
+        rule->setState(state);
+    }
+    return true;
+}
+
+bool CanonicalParser::parseWeekdaySelector(std::unique_ptr<WeekdayRange> *selector)
+{
+    do {
+        if (!parseWeekdayRange(selector)) {
+            return false;
+        }
+        if (selector) {
+            selector = &(*selector)->next;
+        }
+    } while (consumeListSeparator());
+    return true;
+}
+
+bool CanonicalParser::parseWeekdayRange(std::unique_ptr<WeekdayRange> *range)
+{
+    if (consume("PH")) {
+        m_capabilities |= Capability::PublicHoliday;
+        if (range) {
+            range->reset(new WeekdayRange);
+            (*range)->holiday = WeekdayRange::PublicHoliday;
+        }
+        return true;
+    }
+
+    const auto beginDay = parseWeekday();
+    auto endDay = beginDay;
+    if (beginDay == 0 || (consume("-") && (endDay = parseWeekday()) == 0)) {
+        return false;
+    }
+    if (range) {
+        range->reset(new WeekdayRange);
+        (*range)->beginDay = beginDay;
+        (*range)->endDay = endDay;
+    }
+    return true;
+}
+
+bool CanonicalParser::parseTimeSelector(std::vector<Timespan> *selectors)
+{
+    do {
+        Timespan span;
+        if (!parseTimespan(selectors ? &span : nullptr)) {
+            return false;
+        }
+        if (selectors) {
+            selectors->push_back(span);
+        }
+    } while (consumeListSeparator());
+    return true;
+}
+
+bool CanonicalParser::parseTimespan(Timespan *span)
+{
+    Time begin;
+    Time end;
+    if (!parseTime(begin) || !consume("-") || !parseTime(end)) {
+        return false;
+    }
+    m_capabilities |= Capability::Interval;
+    if (span) {
+        span->begin = begin;
+        span->end = end;
+    }
+    return true;
+}
+
+bool CanonicalParser::parseTime(Time &time)
+{
+    if (m_end - m_it < 5 || !isDigit(m_it[0]) || !isDigit(m_it[1]) || m_it[2] != ':' || !isDigit(m_it[3]) || !isDigit(m_it[4])) {
+        return false;
+    }
+    time = { Time::NoEvent, (m_it[0] - '0') * 10 + m_it[1] - '0', (m_it[3] - '0') * 10 + m_it[4] - '0' };
+    m_it += 5;
+    // invalid times are reported by the full parser
+    return Time::isValid(time) && (m_it == m_end || !isDigit(*m_it));
+}
+
+bool CanonicalParser::parseState(State &state)
+{
+    if (consume("off")) {
+        state = State::Off;
+    } else if (consume("closed")) {
+        state = State::Closed;
+    } else if (consume("open")) {
+        state = State::Open;
+    } else if (consume("unknown")) {
+        state = State::Unknown;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int CanonicalParser::parseWeekday()
+{
+    static constexpr const char weekdays[] = "MoTuWeThFrSaSu";
+    if (m_end - m_it < 2) {
+        return 0;
+    }
+    for (int i = 0; i < 7; ++i) {
+        if (m_it[0] == weekdays[2 * i] && m_it[1] == weekdays[2 * i + 1]) {
+            m_it += 2;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+bool CanonicalParser::consume(const char *token)
+{
+    const auto len = std::strlen(token);
+    if ((std::size_t)(m_end - m_it) < len || std::strncmp(m_it, token, len) != 0) {
+        return false;
+    }
+    m_it += len;
+    return true;
+}
+
+bool CanonicalParser::consumeListSeparator()
+{
+    // ", " is a rule separator rather than a list separator
+    if (m_it + 1 < m_end && m_it[0] == ',' && m_it[1] != ' ') {
+        ++m_it;
+        return true;
+    }
+    return false;
+}
+
+bool CanonicalParser::atRuleEnd() const
+{
+    return m_it == m_end || *m_it == ';' || (m_it + 1 < m_end && m_it[0] == ',' && m_it[1] == ' ');
+}
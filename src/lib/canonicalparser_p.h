@@ -0,0 +1,63 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_CANONICALPARSER_P_H
+#define KOPENINGHOURS_CANONICALPARSER_P_H
+
+#include "rule_p.h"
+
+#include <memory>
+#include <vector>
+
+namespace KOpeningHours {
+
+class OpeningHoursPrivate;
+
+/** Recursive descent parser for expressions that are already in canonical form.
+ *  This only covers the most common subset of the syntax, ie. rules consisting of
+ *  weekday ranges, PH, time spans and a state, separated by "; " or ", ".
+ *  Anything outside of that is left to the full (bison) parser, the result for the
+ *  supported subset is identical in both cases.
+ */
+class CanonicalParser
+{
+public:
+    explicit CanonicalParser(const char *data, std::size_t size);
+
+    /** Parse the input and add the resulting rules to @p context.
+     *  If @p context is @c nullptr, the input is only checked for validity, without
+     *  creating any rules.
+     *  @returns @c false if the input contains anything not supported here,
+     *  @p context remains unchanged in that case.
+     */
+    bool parse(OpeningHoursPrivate *context);
+
+    /** Capabilities required by the parsed expression, see Capability::RequiredCapabilities. */
+    int capabilities() const;
+
+private:
+    // the below parse rule contents into their arguments if those are not null
+    bool parseRule(Rule *rule);
+    bool parseWeekdaySelector(std::unique_ptr<WeekdayRange> *selector);
+    bool parseWeekdayRange(std::unique_ptr<WeekdayRange> *range);
+    bool parseTimeSelector(std::vector<Timespan> *selectors);
+    bool parseTimespan(Timespan *span);
+    bool parseTime(Time &time);
+    bool parseState(State &state);
+    int parseWeekday();
+    bool consume(const char *token);
+    bool consumeListSeparator();
+    bool atRuleEnd() const;
+
+    const char *m_it;
+    const char *m_end;
+    Rule::Type m_ruleType = Rule::NormalRule;
+    int m_capabilities = Capability::None;
+};
+
+}
+
+#endif // KOPENINGHOURS_CANONICALPARSER_P_H
@@ -0,0 +1,92 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_CIVILDATE_P_H
+#define KOPENINGHOURS_CIVILDATE_P_H
+
+#include <QtGlobal>
+
+namespace KOpeningHours {
+
+/** Integer Gregorian calendar arithmetic on days, compatible with QDate::toJulianDay().
+ *  This avoids the calendar dispatch and repeated date decomposition of QDate and QCalendar
+ *  for the date computations of the evaluator. Years are numbered as in QDate for all
+ *  years after 0.
+ */
+namespace CivilDate
+{
+    struct Date {
+        int year;
+        int month;
+        int day;
+    };
+
+    /** QDate::toJulianDay() of 1970-01-01. */
+    constexpr qint64 UnixEpochJulianDay = 2440588;
+
+    constexpr bool isLeapYear(int year)
+    {
+        return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    }
+
+    constexpr int daysInMonth(int year, int month)
+    {
+        return month == 2 ? (isLeapYear(year) ? 29 : 28) : 30 + ((month + (month >> 3)) & 1);
+    }
+
+    /** Julian day of the given date, see QDate::toJulianDay(). */
+    constexpr qint64 toJulianDay(int year, int month, int day)
+    {
+        // computed in 400 year eras starting on March 1st, see https://howardhinnant.github.io/date_algorithms.html
+        const qint64 y = year - (month <= 2 ? 1 : 0);
+        const qint64 era = (y >= 0 ? y : y - 399) / 400;
+        const qint64 yearOfEra = y - era * 400;
+        const qint64 dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        const qint64 dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + dayOfEra - 719468 + UnixEpochJulianDay;
+    }
+
+    /** Date for the given Julian day, see QDate::fromJulianDay(). */
+    constexpr Date fromJulianDay(qint64 julianDay)
+    {
+        const qint64 z = julianDay - UnixEpochJulianDay + 719468;
+        const qint64 era = (z >= 0 ? z : z - 146096) / 146097;
+        const qint64 dayOfEra = z - era * 146097;
+        const qint64 yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        const qint64 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        const qint64 mp = (5 * dayOfYear + 2) / 153;
+        const int month = int(mp < 10 ? mp + 3 : mp - 9);
+        return { int(yearOfEra + era * 400 + (month <= 2 ? 1 : 0)), month, int(dayOfYear - (153 * mp + 2) / 5 + 1) };
+    }
+
+    /** Day of week, Mo=1, ..., Su=7, see QDate::dayOfWeek(). */
+    constexpr int dayOfWeek(qint64 julianDay)
+    {
+        return (julianDay % 7 + 7) % 7 + 1;
+    }
+
+    /** ISO 8601 week number, see QDate::weekNumber(). */
+    constexpr int weekNumber(qint64 julianDay)
+    {
+        // the week belongs to the year containing its Thursday
+        const auto thursday = julianDay - dayOfWeek(julianDay) + 4;
+        return int((thursday - toJulianDay(fromJulianDay(thursday).year, 1, 1)) / 7 + 1);
+    }
+
+    /** Julian day of the first day of @p year that is in week 1.
+     *  That is January 1st if that is in week 1, otherwise the first Monday in January.
+     */
+    constexpr qint64 firstDayInWeekOne(int year)
+    {
+        const auto newYear = toJulianDay(year, 1, 1);
+        const auto weekday = dayOfWeek(newYear);
+        return weekday <= 4 ? newYear : newYear + 8 - weekday;
+    }
+}
+
+}
+
+#endif // KOPENINGHOURS_CIVILDATE_P_H
@@ -9,17 +9,21 @@
 #include "logging.h"
 #include "openinghours_p.h"
 
+#include "civildate_p.h"
 #include "easter_p.h"
 #include "holidaycache_p.h"
 
-#include <QCalendar>
 #include <QDateTime>
 
+#include <algorithm>
+#include <limits>
+
 using namespace KOpeningHours;
 
 static int daysInMonth(const QDate &date)
 {
-    return date.daysInMonth(QCalendar(QCalendar::System::Gregorian));
+    const auto d = CivilDate::fromJulianDay(date.toJulianDay());
+    return CivilDate::daysInMonth(d.year, d.month);
 }
 
 static QDateTime resolveTime(Time t, QDate date, OpeningHoursPrivate *context)
@@ -51,11 +55,7 @@ bool Timespan::isMultiDay(QDate date, OpeningHoursPrivate *context) const
     const auto beginDt = resolveTime(begin, date, context);
     const auto realEnd = adjustedEnd();
     auto endDt = resolveTime(realEnd, date, context);
-    if (endDt < beginDt || (realEnd.hour >= 24 && begin.hour < 24)) {
-        return true;
-    }
-
-    return next ? next->isMultiDay(date, context) : false;
+    return endDt < beginDt || (realEnd.hour >= 24 && begin.hour < 24);
 }
 
 SelectorResult Timespan::nextInterval(const Interval &interval, const QDateTime &dt, OpeningHoursPrivate *context) const
@@ -91,16 +91,20 @@ static QDate nthWeekdayFromDate(QDate start, int weekDay, int n)
 
 static QDate nthWeekdayInMonth(QDate month, int weekDay, int n)
 {
+    if (!month.isValid()) {
+        return {};
+    }
+    const auto d = CivilDate::fromJulianDay(month.toJulianDay());
+    const auto firstOfMonth = CivilDate::toJulianDay(d.year, d.month, 1);
+    const auto lastOfMonth = firstOfMonth + CivilDate::daysInMonth(d.year, d.month) - 1;
     if (n > 0) {
-        const auto firstOfMonth = QDate{month.year(), month.month(), 1};
-        const auto delta = (7 + weekDay - firstOfMonth.dayOfWeek()) % 7;
-        const auto day = firstOfMonth.addDays(7 * (n - 1) + delta);
-        return day.month() == month.month() ? day : QDate();
+        const auto delta = (7 + weekDay - CivilDate::dayOfWeek(firstOfMonth)) % 7;
+        const auto day = firstOfMonth + 7 * (n - 1) + delta;
+        return day <= lastOfMonth ? QDate::fromJulianDay(day) : QDate();
     } else {
-        const auto lastOfMonth = QDate{month.year(), month.month(), daysInMonth(month)};
-        const auto delta = (7 + lastOfMonth.dayOfWeek() - weekDay) % 7;
-        const auto day = lastOfMonth.addDays(7 * (n + 1) - delta);
-        return day.month() == month.month() ? day : QDate();
+        const auto delta = (7 + CivilDate::dayOfWeek(lastOfMonth) - weekDay) % 7;
+        const auto day = lastOfMonth + 7 * (n + 1) - delta;
+        return day >= firstOfMonth ? QDate::fromJulianDay(day) : QDate();
     }
 }
 
@@ -158,30 +162,52 @@ SelectorResult WeekdayRange::nextIntervalLocal(const Interval &interval, const Q
                     return smallestOffset;
                 }
 
-                // skip to next month
-                return dt.secsTo(QDateTime(dt.date().addDays(dt.date().daysTo({dt.date().year(), dt.date().month(), daysInMonth(dt.date())}) + 1 + offset) , {0, 0}));
+                // skip directly to the next month containing any of the requested days, rather than
+                // evaluating every month in between (e.g. for Mo[5] that's at most three months ahead)
+                auto d = CivilDate::fromJulianDay(dt.date().addDays(-offset).toJulianDay());
+                auto nextMonth = CivilDate::toJulianDay(d.year, d.month, 1) + CivilDate::daysInMonth(d.year, d.month);
+                for (int month = 0; month < 12; ++month) {
+                    qint64 nextDay = std::numeric_limits<qint64>::max();
+                    for (const NthEntry &entry : nthSequence->sequence) {
+                        for (int n = entry.begin; n <= entry.end; ++n) {
+                            const auto nth = nthWeekdayInMonth(QDate::fromJulianDay(nextMonth), beginDay, n);
+                            if (nth.isValid() && nth.toJulianDay() + offset > dt.date().toJulianDay()) {
+                                nextDay = std::min(nextDay, nth.toJulianDay() + offset);
+                            }
+                        }
+                    }
+                    if (nextDay != std::numeric_limits<qint64>::max()) {
+                        return dt.secsTo(QDateTime(QDate::fromJulianDay(nextDay), {0, 0}));
+                    }
+                    d = CivilDate::fromJulianDay(nextMonth);
+                    nextMonth += CivilDate::daysInMonth(d.year, d.month);
+                }
+                d = CivilDate::fromJulianDay(dt.date().toJulianDay());
+                return dt.secsTo(QDateTime(QDate::fromJulianDay(CivilDate::toJulianDay(d.year, d.month, 1) + CivilDate::daysInMonth(d.year, d.month) + offset), {0, 0}));
             }
 
+            const auto day = dt.date().toJulianDay();
+            const auto weekday = CivilDate::dayOfWeek(day);
             if (beginDay <= endDay) {
-                if (dt.date().dayOfWeek() < beginDay) {
-                    const auto d = beginDay - dt.date().dayOfWeek();
-                    return dt.secsTo(QDateTime(dt.date().addDays(d), {0, 0}));
+                if (weekday < beginDay) {
+                    const auto d = beginDay - weekday;
+                    return dt.secsTo(QDateTime(QDate::fromJulianDay(day + d), {0, 0}));
                 }
-                if (dt.date().dayOfWeek() > endDay) {
-                    const auto d = 7 + beginDay - dt.date().dayOfWeek();
-                    return dt.secsTo(QDateTime(dt.date().addDays(d), {0, 0}));
+                if (weekday > endDay) {
+                    const auto d = 7 + beginDay - weekday;
+                    return dt.secsTo(QDateTime(QDate::fromJulianDay(day + d), {0, 0}));
                 }
             } else {
-                if (dt.date().dayOfWeek() < beginDay && dt.date().dayOfWeek() > endDay) {
-                    const auto d = beginDay - dt.date().dayOfWeek();
-                    return dt.secsTo(QDateTime(dt.date().addDays(d), {0, 0}));
+                if (weekday < beginDay && weekday > endDay) {
+                    const auto d = beginDay - weekday;
+                    return dt.secsTo(QDateTime(QDate::fromJulianDay(day + d), {0, 0}));
                 }
             }
 
             auto i = interval;
-            const auto d = beginDay - dt.date().dayOfWeek();
-            i.setBegin(QDateTime(dt.date().addDays(d), {0, 0}));
-            i.setEnd(QDateTime(i.begin().date().addDays(1 + (beginDay <= endDay ? endDay - beginDay : 7 - (beginDay - endDay))), {0, 0}));
+            const auto begin = day + beginDay - weekday;
+            i.setBegin(QDateTime(QDate::fromJulianDay(begin), {0, 0}));
+            i.setEnd(QDateTime(QDate::fromJulianDay(begin + 1 + (beginDay <= endDay ? endDay - beginDay : 7 - (beginDay - endDay))), {0, 0}));
             return i;
         }
         case PublicHoliday:
@@ -211,34 +237,36 @@ SelectorResult WeekdayRange::nextIntervalLocal(const Interval &interval, const Q
 SelectorResult Week::nextInterval(const Interval &interval, const QDateTime &dt, OpeningHoursPrivate *context) const
 {
     Q_UNUSED(context);
-    if (dt.date().weekNumber() < beginWeek) {
-        const auto days = (7 - dt.date().dayOfWeek()) + 7 * (beginWeek - dt.date().weekNumber() - 1) + 1;
-        return dt.secsTo(QDateTime(dt.date().addDays(days), {0, 0}));
-    }
-    if (dt.date().weekNumber() > endWeek) {
+    const auto day = dt.date().toJulianDay();
+    const auto weekday = CivilDate::dayOfWeek(day);
+    const auto weekNumber = CivilDate::weekNumber(day);
+    if (weekNumber < beginWeek) {
+        const auto days = (7 - weekday) + 7 * (beginWeek - weekNumber - 1) + 1;
+        return dt.secsTo(QDateTime(QDate::fromJulianDay(day + days), {0, 0}));
+    }
+    if (weekNumber > endWeek) {
         // "In accordance with ISO 8601, weeks start on Monday and the first Thursday of a year is always in week 1 of that year."
-        auto d = QDateTime({dt.date().year() + 1, 1, 1}, {0, 0});
-        while (d.date().weekNumber() != 1) {
-            d = d.addDays(1);
-        }
-        return dt.secsTo(d);
+        const auto nextYear = CivilDate::fromJulianDay(day).year + 1;
+        return dt.secsTo(QDateTime(QDate::fromJulianDay(CivilDate::firstDayInWeekOne(nextYear)), {0, 0}));
     }
 
     if (this->interval > 1) {
-        const int wd = (dt.date().weekNumber() - beginWeek) % this->interval;
+        const int wd = (weekNumber - beginWeek) % this->interval;
         if (wd) {
-            const auto days = (7 - dt.date().dayOfWeek()) + 7 * (this->interval - wd - 1) + 1;
-            return dt.secsTo(QDateTime(dt.date().addDays(days), {0, 0}));
+            const auto days = (7 - weekday) + 7 * (this->interval - wd - 1) + 1;
+            return dt.secsTo(QDateTime(QDate::fromJulianDay(day + days), {0, 0}));
         }
     }
 
     auto i = interval;
     if (this->interval > 1) {
-        i.setBegin(QDateTime(dt.date().addDays(1 - dt.date().dayOfWeek()), {0, 0}));
-        i.setEnd(QDateTime(i.begin().date().addDays(7), {0, 0}));
+        const auto begin = day + 1 - weekday;
+        i.setBegin(QDateTime(QDate::fromJulianDay(begin), {0, 0}));
+        i.setEnd(QDateTime(QDate::fromJulianDay(begin + 7), {0, 0}));
     } else {
-        i.setBegin(QDateTime(dt.date().addDays(1 - dt.date().dayOfWeek() - 7 * (dt.date().weekNumber() - beginWeek)), {0, 0}));
-        i.setEnd(QDateTime(i.begin().date().addDays((1 + endWeek - beginWeek) * 7), {0, 0}));
+        const auto begin = day + 1 - weekday - 7 * (weekNumber - beginWeek);
+        i.setBegin(QDateTime(QDate::fromJulianDay(begin), {0, 0}));
+        i.setEnd(QDateTime(QDate::fromJulianDay(begin + (1 + endWeek - beginWeek) * 7), {0, 0}));
     }
     return i;
 }
@@ -360,100 +388,110 @@ RuleResult Rule::nextInterval(const QDateTime &dt, OpeningHoursPrivate *context)
     // consider e.g. "Tu 12:00-12:00" being evaluated with dt being Wednesday 08:00
     // we need to look one day back to find a matching day selector and the correct start
     // of the interval here
-    if (m_timeSelector && m_timeSelector->isMultiDay(dt.date(), context)) {
-        const auto res = nextInterval(dt.addDays(-1), context, RecursionLimit);
+    const auto isMultiDay = std::any_of(m_timeSelectors.begin(), m_timeSelectors.end(), [&dt, context](const Timespan &s) {
+        return s.isMultiDay(dt.date(), context);
+    });
+    if (isMultiDay) {
+        const auto res = findNextInterval(dt.addDays(-1), context);
         if (res.interval.contains(dt)) {
             return res;
         }
     }
 
-    return nextInterval(dt, context, RecursionLimit);
+    return findNextInterval(dt, context);
 }
 
-RuleResult Rule::nextInterval(const QDateTime &dt, OpeningHoursPrivate *context, int recursionBudget) const
+RuleResult Rule::findNextInterval(QDateTime dt, OpeningHoursPrivate *context) const
 {
-    const auto resultMode = (recursionBudget == Rule::RecursionLimit && m_ruleType == NormalRule && state() != Interval::Closed) ? RuleResult::Override : RuleResult::Merge;
-
-    if (recursionBudget == 0) {
-        context->m_error = OpeningHours::EvaluationError;
-        qCWarning(Log) << "Recursion limited reached!";
-        return {{}, resultMode};
-    }
+    auto resultMode = (m_ruleType == NormalRule && state() != Interval::Closed) ? RuleResult::Override : RuleResult::Merge;
 
-    Interval i;
-    i.setState(state());
-    i.setComment(m_comment);
-    if (!m_timeSelector && !m_weekdaySelector && !m_monthdaySelector && !m_weekSelector && !m_yearSelector) {
+    if (m_timeSelectors.empty() && !m_weekdaySelector && m_monthdaySelectors.empty() && m_weekSelectors.empty() && m_yearSelectors.empty()) {
         // 24/7 has no selectors
+        Interval i;
+        i.setState(state());
+        i.setComment(m_comment);
         return {i, resultMode};
     }
 
-    if (m_yearSelector) {
-        SelectorResult r;
-        for (auto s = m_yearSelector.get(); s; s = s->next.get()) {
-            r = std::min(r, s->nextInterval(i, dt, context));
-        }
+    // selectors not matching at dt tell us when they can match next, evaluation continues from
+    // there until all selectors match
+    for (int step = 0; step < MaximumSteps; ++step) {
+        bool isTimeSelectorOffset = false;
+        const auto r = matchSelectors(dt, context, isTimeSelectorOffset);
         if (!r.canMatch()) {
             return {{}, resultMode};
         }
-        if (r.matchOffset() > 0) {
-            return nextInterval(dt.addSecs(r.matchOffset()), context, --recursionBudget);
+        if (r.matchOffset() <= 0) {
+            return {r.interval(), resultMode};
         }
-        i = r.interval();
+        // results found after skipping to a later date never override preceding rules
+        if (step == 0 && !isTimeSelectorOffset) {
+            resultMode = RuleResult::Merge;
+        }
+        dt = dt.addSecs(r.matchOffset());
     }
 
-    if (m_monthdaySelector) {
-        SelectorResult r;
-        for (auto s = m_monthdaySelector.get(); s; s = s->next.get()) {
-            r = std::min(r, s->nextInterval(i, dt, context));
-        }
-        if (!r.canMatch()) {
-            return {{}, resultMode};
-        }
-        if (r.matchOffset() > 0) {
-            return nextInterval(dt.addSecs(r.matchOffset()), context, --recursionBudget);
+    context->m_error = OpeningHours::EvaluationError;
+    qCWarning(Log) << "Evaluation step limit reached!";
+    return {{}, resultMode};
+}
+
+template <typename T>
+static SelectorResult nextSelectorInterval(const std::vector<T> &selectors, const Interval &interval, const QDateTime &dt, OpeningHoursPrivate *context)
+{
+    SelectorResult r;
+    for (const auto &s : selectors) {
+        r = std::min(r, s.nextInterval(interval, dt, context));
+    }
+    return r;
+}
+
+SelectorResult Rule::matchSelectors(const QDateTime &dt, OpeningHoursPrivate *context, bool &isTimeSelectorOffset) const
+{
+    Interval i;
+    i.setState(state());
+    i.setComment(m_comment);
+
+    if (!m_yearSelectors.empty()) {
+        const auto r = nextSelectorInterval(m_yearSelectors, i, dt, context);
+        if (!r.canMatch() || r.matchOffset() > 0) {
+            return r;
         }
         i = r.interval();
     }
 
-    if (m_weekSelector) {
-        SelectorResult r;
-        for (auto s = m_weekSelector.get(); s; s = s->next.get()) {
-            r = std::min(r, s->nextInterval(i, dt, context));
+    if (!m_monthdaySelectors.empty()) {
+        const auto r = nextSelectorInterval(m_monthdaySelectors, i, dt, context);
+        if (!r.canMatch() || r.matchOffset() > 0) {
+            return r;
         }
-        if (!r.canMatch()) {
-            return {{}, resultMode};
-        }
-        if (r.matchOffset() > 0) {
-            return nextInterval(dt.addSecs(r.matchOffset()), context, --recursionBudget);
+        i = r.interval();
+    }
+
+    if (!m_weekSelectors.empty()) {
+        const auto r = nextSelectorInterval(m_weekSelectors, i, dt, context);
+        if (!r.canMatch() || r.matchOffset() > 0) {
+            return r;
         }
         i = r.interval();
     }
 
     if (m_weekdaySelector) {
-        SelectorResult r = m_weekdaySelector->nextInterval(i, dt, context);
-        if (!r.canMatch()) {
-            return {{}, resultMode};
-        }
-        if (r.matchOffset() > 0) {
-            return nextInterval(dt.addSecs(r.matchOffset()), context, --recursionBudget);
+        const auto r = m_weekdaySelector->nextInterval(i, dt, context);
+        if (!r.canMatch() || r.matchOffset() > 0) {
+            return r;
         }
         i = r.interval();
     }
 
-    if (m_timeSelector) {
-        SelectorResult r;
-        for (auto s = m_timeSelector.get(); s; s = s->next.get()) {
-            r = std::min(r, s->nextInterval(i, dt, context));
-        }
-        if (!r.canMatch()) {
-            return {{}, resultMode};
-        }
-        if (r.matchOffset() > 0) {
-            return {nextInterval(dt.addSecs(r.matchOffset()), context, --recursionBudget).interval, resultMode};
+    if (!m_timeSelectors.empty()) {
+        const auto r = nextSelectorInterval(m_timeSelectors, i, dt, context);
+        if (!r.canMatch() || r.matchOffset() > 0) {
+            isTimeSelectorOffset = true;
+            return r;
         }
         i = r.interval();
     }
 
-    return {i, resultMode};
+    return i;
 }
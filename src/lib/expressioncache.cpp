@@ -0,0 +1,116 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "expressioncache.h"
+#include "openinghours_p.h"
+
+#include <QCache>
+#include <QMutex>
+#include <QPair>
+
+using namespace KOpeningHours;
+
+namespace KOpeningHours {
+
+struct ExpressionCacheEntry {
+    std::shared_ptr<Arena> arena; // needs to outlive rules
+    std::vector<std::shared_ptr<Rule>> rules;
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+    std::shared_ptr<const WeeklyEvaluator> weeklyEvaluator;
+#endif
+    OpeningHours::Error error; // result of parsing, before validation
+};
+
+class ExpressionCachePrivate {
+public:
+    mutable QMutex mutex;
+    QCache<QPair<QByteArray, int>, ExpressionCacheEntry> entries{10000};
+    quint64 hits = 0;
+    quint64 misses = 0;
+};
+}
+
+ExpressionCache::ExpressionCache()
+    : d(new ExpressionCachePrivate)
+{
+}
+
+ExpressionCache::~ExpressionCache() = default;
+
+OpeningHours ExpressionCache::openingHours(const QByteArray &expression, OpeningHours::Modes modes)
+{
+    const auto key = qMakePair(expression, static_cast<int>(modes));
+    OpeningHours oh;
+    {
+        QMutexLocker locker(&d->mutex);
+        if (const auto entry = d->entries.object(key)) {
+            ++d->hits;
+            oh.d->m_arena = entry->arena;
+            oh.d->m_rules = entry->rules;
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+            oh.d->m_weeklyEvaluator = entry->weeklyEvaluator;
+#endif
+            oh.d->m_modes = modes;
+            oh.d->m_error = entry->error;
+            locker.unlock();
+            oh.d->validate();
+            return oh;
+        }
+        ++d->misses;
+    }
+
+    // parse outside of the lock, so multiple threads can do this in parallel
+    oh.setExpression(expression, modes);
+    auto entry = new ExpressionCacheEntry;
+    entry->arena = oh.d->m_arena;
+    entry->rules = oh.d->m_rules;
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+    entry->weeklyEvaluator = oh.d->m_weeklyEvaluator;
+#endif
+    entry->error = (oh.d->m_error == OpeningHours::Null || oh.d->m_error == OpeningHours::SyntaxError) ? oh.d->m_error : OpeningHours::NoError;
+
+    QMutexLocker locker(&d->mutex);
+    d->entries.insert(key, entry);
+    return oh;
+}
+
+quint64 ExpressionCache::hits() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->hits;
+}
+
+quint64 ExpressionCache::misses() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->misses;
+}
+
+int ExpressionCache::size() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->entries.size();
+}
+
+int ExpressionCache::maximumSize() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->entries.maxCost();
+}
+
+void ExpressionCache::setMaximumSize(int maximumSize)
+{
+    QMutexLocker locker(&d->mutex);
+    d->entries.setMaxCost(maximumSize);
+}
+
+void ExpressionCache::clear()
+{
+    QMutexLocker locker(&d->mutex);
+    d->entries.clear();
+    d->hits = 0;
+    d->misses = 0;
+}
@@ -0,0 +1,70 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_EXPRESSIONCACHE_H
+#define KOPENINGHOURS_EXPRESSIONCACHE_H
+
+#include "kopeninghours_export.h"
+
+#include <KOpeningHours/OpeningHours>
+
+#include <memory>
+
+namespace KOpeningHours {
+
+class ExpressionCachePrivate;
+
+/** Cache of parsed opening hours expressions.
+ *  Real-world data sets contain the same expressions very often, this allows to
+ *  parse each distinct expression only once. The parsed rules are shared between all
+ *  OpeningHours instances created for the same expression, location, region and timezone
+ *  settings are not.
+ *
+ *  The cache holds at most maximumSize() expressions, when that is exceeded the least recently
+ *  used ones are discarded.
+ *
+ *  All methods of this class are thread-safe.
+ *  @since 26.08.0
+ */
+class KOPENINGHOURS_EXPORT ExpressionCache
+{
+public:
+    explicit ExpressionCache();
+    ~ExpressionCache();
+
+    /** Returns an OpeningHours instance for @p expression.
+     *  This is equivalent to constructing an OpeningHours instance for @p expression and @p modes,
+     *  but only parses @p expression if it hasn't been seen before.
+     */
+    OpeningHours openingHours(const QByteArray &expression, OpeningHours::Modes modes = OpeningHours::IntervalMode);
+
+    /** Number of lookups answered from the cache. */
+    quint64 hits() const;
+    /** Number of lookups that required parsing the expression. */
+    quint64 misses() const;
+    /** Number of distinct expressions in the cache. */
+    int size() const;
+
+    /** Maximum number of expressions kept in the cache.
+     *  Defaults to 10000.
+     */
+    int maximumSize() const;
+    /** Sets the maximum number of expressions kept in the cache to @p maximumSize.
+     *  If the cache currently contains more expressions, the least recently used ones are discarded.
+     */
+    void setMaximumSize(int maximumSize);
+
+    /** Removes all entries from the cache and resets the hit and miss counters. */
+    void clear();
+
+private:
+    Q_DISABLE_COPY(ExpressionCache)
+    std::unique_ptr<ExpressionCachePrivate> d;
+};
+
+}
+
+#endif // KOPENINGHOURS_EXPRESSIONCACHE_H
@@ -0,0 +1,20 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "fastpath_p.h"
+
+#include <QtGlobal>
+
+using namespace KOpeningHours;
+
+bool KOpeningHours::isFastPathEnabled(FastPath path)
+{
+    static const bool s_enabled[] = {
+        !qEnvironmentVariableIsSet("KOPENINGHOURS_NO_CANONICAL_PARSER"),
+        !qEnvironmentVariableIsSet("KOPENINGHOURS_NO_WEEKLY_EVALUATOR"),
+    };
+    return s_enabled[static_cast<int>(path)];
+}
@@ -0,0 +1,27 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_FASTPATH_P_H
+#define KOPENINGHOURS_FASTPATH_P_H
+
+namespace KOpeningHours {
+
+/** Optimized code paths that can be bypassed in favor of the general implementation.
+ *  Each of those produces the same results as the code it bypasses. To test and benchmark
+ *  the general implementation, they can be disabled by setting the corresponding environment
+ *  variable. Those are read once on first use.
+ */
+enum class FastPath {
+    CanonicalParser, ///< CanonicalParser in front of the full parser, KOPENINGHOURS_NO_CANONICAL_PARSER
+    WeeklyEvaluator, ///< WeeklyEvaluator in front of the full evaluator, KOPENINGHOURS_NO_WEEKLY_EVALUATOR
+};
+
+/** Returns whether @p path is used. */
+bool isFastPathEnabled(FastPath path);
+
+}
+
+#endif // KOPENINGHOURS_FASTPATH_P_H
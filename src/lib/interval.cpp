@@ -46,6 +46,22 @@ bool Interval::operator<(const Interval &other) const
     return d->begin < other.d->begin;
 }
 
+bool Interval::operator==(const Interval &other) const
+{
+    return d == other.d
+        || (d->begin == other.d->begin
+        && d->end == other.d->end
+        && d->state == other.d->state
+        && d->openEndTime == other.d->openEndTime
+        && d->estimatedEnd == other.d->estimatedEnd
+        && d->comment == other.d->comment);
+}
+
+bool Interval::operator!=(const Interval &other) const
+{
+    return !operator==(other);
+}
+
 bool Interval::intersects(const Interval &other) const
 {
     if (d->end.isValid() && other.d->begin.isValid() && d->end <= other.d->begin) {
@@ -43,6 +43,14 @@ public:
 
     /** Check whether this interval starts before @p other. */
     bool operator<(const Interval &other) const;
+    /** Check whether this interval and @p other have the same time range, state and comment.
+     *  @since 26.08.0
+     */
+    bool operator==(const Interval &other) const;
+    /** Check whether this interval and @p other differ in time range, state or comment.
+     *  @since 26.08.0
+     */
+    bool operator!=(const Interval &other) const;
 
     /** Default constructed empty/invalid interval. */
     bool isValid() const;
@@ -25,6 +25,7 @@ struct DayData {
 class IntervalModelPrivate {
 public:
     void repopulateModel();
+    std::vector<DayData> populateDays() const;
 
     OpeningHours oh;
     std::vector<DayData> m_intervals;
@@ -43,27 +44,35 @@ static void clipIntervalEnd(Interval &i, const QDateTime &endDt)
 
 void IntervalModelPrivate::repopulateModel()
 {
-    m_intervals.clear();
+    m_intervals = populateDays();
+}
+
+std::vector<DayData> IntervalModelPrivate::populateDays() const
+{
+    std::vector<DayData> days;
     if (endDt < beginDt || oh.error() != OpeningHours::NoError) {
-        return;
+        return days;
     }
 
     QDate dt = beginDt;
-    m_intervals.resize(beginDt.daysTo(endDt));
-    for (auto &dayData : m_intervals) {
+    days.resize(beginDt.daysTo(endDt));
+    for (auto &dayData : days) {
         dayData.day = dt;
-        auto i = oh.interval(QDateTime(dt, {0, 0}));
-
-        // clip intervals to the current day, makes displaying much easier
-        i.setBegin(i.hasOpenBegin() ? QDateTime(dt, {0, 0}) : std::max(i.begin(), QDateTime(dt, {0, 0})));
+        const auto dayBegin = QDateTime(dt, {0, 0});
         dt = dt.addDays(1);
-        clipIntervalEnd(i, QDateTime(dt, {0, 0}));
+        const auto dayEnd = QDateTime(dt, {0, 0});
+
+        dayData.intervals = oh.intervals(dayBegin, dayEnd);
+        // an invalid interval marks the remainder of the day without any matching rule
+        if (dayData.intervals.empty() || (!dayData.intervals.back().hasOpenEnd() && dayData.intervals.back().end() < dayEnd)) {
+            dayData.intervals.emplace_back();
+        }
 
-        dayData.intervals.push_back(i);
-        while (i.isValid() && i.end() < QDateTime(dt, {0, 0})) {
-            i = oh.nextInterval(i);
-            clipIntervalEnd(i, QDateTime(dt, {0, 0}));
-            dayData.intervals.push_back(i);
+        // clip intervals to the current day, makes displaying much easier
+        auto &first = dayData.intervals.front();
+        first.setBegin(first.hasOpenBegin() ? dayBegin : std::max(first.begin(), dayBegin));
+        for (auto &i : dayData.intervals) {
+            clipIntervalEnd(i, dayEnd);
         }
 
         // fill open end time estimates
@@ -85,6 +94,7 @@ void IntervalModelPrivate::repopulateModel()
             (*std::next(it)).setBegin(estimatedEnd);
         }
     }
+    return days;
 }
 
 IntervalModel::IntervalModel(QObject *parent)
@@ -105,9 +115,28 @@ void IntervalModel::setOpeningHours(const OpeningHours &oh)
     d->oh = oh;
     emit openingHoursChanged();
 
-    beginResetModel();
-    d->repopulateModel();
-    endResetModel();
+    // while editing an expression most days usually remain the same, so only update
+    // the changed ones rather than resetting everything
+    auto days = d->populateDays();
+    if (days.size() != d->m_intervals.size()) {
+        beginResetModel();
+        d->m_intervals = std::move(days);
+        endResetModel();
+        return;
+    }
+
+    const int count = days.size();
+    for (int i = 0; i < count;) {
+        if (days[i].intervals == d->m_intervals[i].intervals) {
+            ++i;
+            continue;
+        }
+        const auto first = i;
+        for (; i < count && !(days[i].intervals == d->m_intervals[i].intervals); ++i) {
+            d->m_intervals[i] = std::move(days[i]);
+        }
+        emit dataChanged(index(first, 0), index(i - 1, 0), {IntervalsRole});
+    }
 }
 
 QDate IntervalModel::beginDate() const
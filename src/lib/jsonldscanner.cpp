@@ -0,0 +1,376 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "jsonldscanner_p.h"
+
+#include <QByteArray>
+#include <QJsonDocument>
+
+using namespace KOpeningHours;
+
+// same limit as QJsonDocument
+enum { MaximumNestingDepth = 1024 };
+
+static constexpr const char *s_openingHoursMembers[] = { "openingHours", "openingHoursSpecification", "specialOpeningHoursSpecification" };
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int hexValue(char c)
+{
+    if (isDigit(c)) {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+JsonLdScanner::JsonLdScanner(const char *data, std::size_t size)
+    : m_it(data)
+    , m_end(data + size)
+{
+}
+
+QJsonObject JsonLdScanner::openingHoursMembers()
+{
+    // raw JSON of the values of the opening hours members, for repeated members the last one
+    // is used, the same way as in QJsonObject
+    constexpr auto MemberCount = sizeof(s_openingHoursMembers) / sizeof(s_openingHoursMembers[0]);
+    const char *valueBegin[MemberCount] = {};
+    const char *valueEnd[MemberCount] = {};
+
+    skipWhitespace();
+    if (!consume('{')) {
+        return {};
+    }
+    skipWhitespace();
+    if (!consume('}')) {
+        QByteArray name;
+        for (;;) {
+            name.clear();
+            if (!parseString(&name)) {
+                return {};
+            }
+            skipWhitespace();
+            if (!consume(':')) {
+                return {};
+            }
+            skipWhitespace();
+            const auto begin = m_it;
+            if (!skipValue(1)) {
+                return {};
+            }
+            for (std::size_t i = 0; i < MemberCount; ++i) {
+                if (name == s_openingHoursMembers[i]) {
+                    valueBegin[i] = begin;
+                    valueEnd[i] = m_it;
+                }
+            }
+            skipWhitespace();
+            if (consume('}')) {
+                break;
+            }
+            if (!consume(',')) {
+                return {};
+            }
+            skipWhitespace();
+        }
+    }
+    skipWhitespace();
+    if (m_it != m_end) {
+        return {};
+    }
+
+    QByteArray json;
+    for (std::size_t i = 0; i < MemberCount; ++i) {
+        if (!valueBegin[i]) {
+            continue;
+        }
+        json += json.isEmpty() ? "{\"" : ",\"";
+        json += s_openingHoursMembers[i];
+        json += "\":";
+        json.append(valueBegin[i], valueEnd[i] - valueBegin[i]);
+    }
+    if (json.isEmpty()) {
+        return {};
+    }
+    json += '}';
+    return QJsonDocument::fromJson(json).object();
+}
+
+bool JsonLdScanner::parseString(QByteArray *name)
+{
+    if (!consume('"')) {
+        return false;
+    }
+    while (m_it != m_end) {
+        const auto c = *m_it;
+        if (c == '"') {
+            ++m_it;
+            return true;
+        }
+        if (c == '\\') {
+            if (!skipEscapeSequence(name)) {
+                return false;
+            }
+            continue;
+        }
+        const auto begin = m_it;
+        if (!skipUtf8Sequence()) {
+            return false;
+        }
+        if (name) {
+            name->append(begin, m_it - begin);
+        }
+    }
+    return false;
+}
+
+bool JsonLdScanner::skipValue(int depth)
+{
+    if (m_it == m_end) {
+        return false;
+    }
+    switch (*m_it) {
+    case '"':
+        return parseString(nullptr);
+    case '{':
+        return skipObject(depth + 1);
+    case '[':
+        return skipArray(depth + 1);
+    case 't':
+        return consume("true");
+    case 'f':
+        return consume("false");
+    case 'n':
+        return consume("null");
+    default:
+        return skipNumber();
+    }
+}
+
+bool JsonLdScanner::skipObject(int depth)
+{
+    if (depth > MaximumNestingDepth) {
+        return false;
+    }
+    ++m_it;
+    skipWhitespace();
+    if (consume('}')) {
+        return true;
+    }
+    for (;;) {
+        if (!parseString(nullptr)) {
+            return false;
+        }
+        skipWhitespace();
+        if (!consume(':')) {
+            return false;
+        }
+        skipWhitespace();
+        if (!skipValue(depth)) {
+            return false;
+        }
+        skipWhitespace();
+        if (consume('}')) {
+            return true;
+        }
+        if (!consume(',')) {
+            return false;
+        }
+        skipWhitespace();
+    }
+}
+
+bool JsonLdScanner::skipArray(int depth)
+{
+    if (depth > MaximumNestingDepth) {
+        return false;
+    }
+    ++m_it;
+    skipWhitespace();
+    if (consume(']')) {
+        return true;
+    }
+    for (;;) {
+        if (!skipValue(depth)) {
+            return false;
+        }
+        skipWhitespace();
+        if (consume(']')) {
+            return true;
+        }
+        if (!consume(',')) {
+            return false;
+        }
+        skipWhitespace();
+    }
+}
+
+bool JsonLdScanner::skipNumber()
+{
+    consume('-');
+    if (!consume('0') && !skipDigits()) {
+        return false;
+    }
+    if (consume('.') && !skipDigits()) {
+        return false;
+    }
+    if (consume('e') || consume('E')) {
+        if (!consume('+')) {
+            consume('-');
+        }
+        return skipDigits();
+    }
+    return true;
+}
+
+bool JsonLdScanner::skipDigits()
+{
+    const auto begin = m_it;
+    while (m_it != m_end && isDigit(*m_it)) {
+        ++m_it;
+    }
+    return m_it != begin;
+}
+
+bool JsonLdScanner::skipEscapeSequence(QByteArray *name)
+{
+    if (m_end - m_it < 2) {
+        return false;
+    }
+    const auto c = m_it[1];
+    m_it += 2;
+    char decoded = 0;
+    switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+        decoded = c;
+        break;
+    case 'b':
+        decoded = '\b';
+        break;
+    case 'f':
+        decoded = '\f';
+        break;
+    case 'n':
+        decoded = '\n';
+        break;
+    case 'r':
+        decoded = '\r';
+        break;
+    case 't':
+        decoded = '\t';
+        break;
+    case 'u':
+        break;
+    default:
+        return false;
+    }
+    if (decoded) {
+        if (name) {
+            name->append(decoded);
+        }
+        return true;
+    }
+
+    if (m_end - m_it < 4) {
+        return false;
+    }
+    int codeUnit = 0;
+    for (int i = 0; i < 4; ++i) {
+        const auto v = hexValue(m_it[i]);
+        if (v < 0) {
+            return false;
+        }
+        codeUnit = codeUnit * 16 + v;
+    }
+    m_it += 4;
+    if (name) {
+        // anything outside of ASCII can't match the member names we look for
+        name->append(codeUnit < 0x80 ? char(codeUnit) : '\x80');
+    }
+    return true;
+}
+
+bool JsonLdScanner::skipUtf8Sequence()
+{
+    // see the table of well-formed UTF-8 byte sequences in the Unicode standard, section 3.9
+    const auto b0 = static_cast<unsigned char>(*m_it);
+    if (b0 < 0x80) {
+        ++m_it;
+        return true;
+    }
+
+    int length = 0;
+    unsigned char min = 0x80;
+    unsigned char max = 0xBF;
+    if (b0 >= 0xC2 && b0 <= 0xDF) {
+        length = 2;
+    } else if (b0 >= 0xE0 && b0 <= 0xEF) {
+        length = 3;
+        min = b0 == 0xE0 ? 0xA0 : 0x80;
+        max = b0 == 0xED ? 0x9F : 0xBF;
+    } else if (b0 >= 0xF0 && b0 <= 0xF4) {
+        length = 4;
+        min = b0 == 0xF0 ? 0x90 : 0x80;
+        max = b0 == 0xF4 ? 0x8F : 0xBF;
+    } else {
+        return false;
+    }
+
+    if (m_end - m_it < length) {
+        return false;
+    }
+    const auto b1 = static_cast<unsigned char>(m_it[1]);
+    if (b1 < min || b1 > max) {
+        return false;
+    }
+    for (int i = 2; i < length; ++i) {
+        const auto b = static_cast<unsigned char>(m_it[i]);
+        if (b < 0x80 || b > 0xBF) {
+            return false;
+        }
+    }
+    m_it += length;
+    return true;
+}
+
+void JsonLdScanner::skipWhitespace()
+{
+    while (m_it != m_end && (*m_it == ' ' || *m_it == '\t' || *m_it == '\n' || *m_it == '\r')) {
+        ++m_it;
+    }
+}
+
+bool JsonLdScanner::consume(char c)
+{
+    if (m_it == m_end || *m_it != c) {
+        return false;
+    }
+    ++m_it;
+    return true;
+}
+
+bool JsonLdScanner::consume(const char *token)
+{
+    auto it = m_it;
+    for (; *token; ++token, ++it) {
+        if (it == m_end || *it != *token) {
+            return false;
+        }
+    }
+    m_it = it;
+    return true;
+}
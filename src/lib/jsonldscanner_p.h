@@ -0,0 +1,58 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_JSONLDSCANNER_P_H
+#define KOPENINGHOURS_JSONLDSCANNER_P_H
+
+#include <QJsonObject>
+
+#include <cstddef>
+
+class QByteArray;
+
+namespace KOpeningHours {
+
+/** Finds the opening hours members of a schema.org object in JSON format, without decoding the entire object.
+ *  Records of a web crawl are mostly made up of members irrelevant for OpeningHours::fromJsonLd(),
+ *  those are only checked for being valid JSON here. Only the values of the openingHours,
+ *  openingHoursSpecification and specialOpeningHoursSpecification members are decoded, by QJsonDocument.
+ */
+class JsonLdScanner
+{
+public:
+    explicit JsonLdScanner(const char *data, std::size_t size);
+
+    /** Scans the input for a single JSON object.
+     *  @returns an object with only the opening hours members of that, or an empty object
+     *  if the input isn't a valid JSON object or has none of those members.
+     */
+    QJsonObject openingHoursMembers();
+
+private:
+    // the below return @c false for invalid input
+    /** Parses a string, and decodes it into @p name if that is not null.
+     *  This is only meant for comparing member names against ASCII names, escaped characters
+     *  outside of ASCII are therefore not decoded exactly.
+     */
+    bool parseString(QByteArray *name);
+    bool skipValue(int depth);
+    bool skipObject(int depth);
+    bool skipArray(int depth);
+    bool skipNumber();
+    bool skipDigits();
+    bool skipEscapeSequence(QByteArray *name);
+    bool skipUtf8Sequence();
+    void skipWhitespace();
+    bool consume(char c);
+    bool consume(const char *token);
+
+    const char *m_it;
+    const char *m_end;
+};
+
+}
+
+#endif // KOPENINGHOURS_JSONLDSCANNER_P_H
@@ -6,29 +6,349 @@
 
 #include "openinghours.h"
 #include "openinghours_p.h"
+#include "binaryformat_p.h"
+#include "canonicalparser_p.h"
+#include "fastpath_p.h"
+#include "jsonldscanner_p.h"
 #include "openinghoursparser_p.h"
 #include "openinghoursscanner_p.h"
 #include "holidaycache_p.h"
 #include "interval.h"
 #include "rule_p.h"
+#include "utf8_p.h"
 #include "logging.h"
 
 #include <QDateTime>
+#include <QIODevice>
 #include <QJsonArray>
 #include <QJsonObject>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
 #include <QTimeZone>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <unordered_map>
+#include <vector>
 
 using namespace KOpeningHours;
 
+namespace {
+struct UnicodeFold {
+    uint32_t utf8; // UTF-8 bytes in big endian order
+    char ascii;
+};
+
+// Unicode variants of characters the scanner treats identically to an ASCII character
+// that has no other use in multi-character tokens
+static constexpr const UnicodeFold unicode_folds[] = {
+    { 0xC2A0, '\t' }, // no-break space
+    { 0xE280AF, '\t' }, // narrow no-break space
+    { 0xE38080, '\t' }, // ideographic space
+    { 0xE28091, '-' }, // non-breaking hyphen
+    { 0xE28092, '-' }, // figure dash
+    { 0xE28093, '-' }, // en dash
+    { 0xE28094, '-' }, // em dash
+    { 0xE28095, '-' }, // horizontal bar
+    { 0xE28892, '-' }, // minus sign
+    { 0xEFBC8D, '-' }, // fullwidth hyphen-minus
+    { 0xE383BC, '-' }, // katakana-hiragana prolonged sound mark
+    { 0xEFBD9E, '~' }, // fullwidth tilde
+    { 0xE3809C, '~' }, // wave dash
+    { 0xE28692, '~' }, // rightwards arrow
+};
+
+// unicode_folds as a perfect hash table, indexed by the UTF-8 bytes modulo its size
+// this has to be adjusted when adding to the above, the static_assert below catches collisions
+enum { UnicodeFoldTableSize = 45 };
+struct UnicodeFoldTable {
+    UnicodeFold folds[UnicodeFoldTableSize];
+};
+
+static constexpr UnicodeFoldTable makeUnicodeFoldTable()
+{
+    UnicodeFoldTable table = {};
+    for (const auto &fold : unicode_folds) {
+        table.folds[fold.utf8 % UnicodeFoldTableSize] = fold;
+    }
+    return table;
+}
+static constexpr const auto unicode_fold_table = makeUnicodeFoldTable();
+
+static constexpr bool isPerfectHash()
+{
+    for (const auto &fold : unicode_folds) {
+        if (unicode_fold_table.folds[fold.utf8 % UnicodeFoldTableSize].utf8 != fold.utf8) {
+            return false;
+        }
+    }
+    return true;
+}
+static_assert(isPerfectHash(), "unicode_folds entries collide in unicode_fold_table");
+
+/** Returns the entry of unicode_folds for the UTF-8 sequence starting at @p it, or @c nullptr. */
+static const UnicodeFold* findUnicodeFold(const char *it, const char *end)
+{
+    const auto lead = static_cast<unsigned char>(*it);
+    const auto len = lead >= 0xF0 ? 0 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 0;
+    if (len == 0 || end - it < len) {
+        return nullptr;
+    }
+    uint32_t utf8 = 0;
+    for (int i = 0; i < len; ++i) {
+        utf8 = (utf8 << 8) | static_cast<unsigned char>(it[i]);
+    }
+    const auto &fold = unicode_fold_table.folds[utf8 % UnicodeFoldTableSize];
+    return fold.utf8 == utf8 ? &fold : nullptr;
+}
+
+static bool isAsciiOrQuote(char c)
+{
+    return static_cast<unsigned char>(c) < 0x80 && c != '"';
+}
+
+static bool isTypographicQuote(const char *it, const char *end)
+{
+    return end - it >= 3 && it[0] == '\xE2' && it[1] == '\x80' && (it[2] == '\x9C' || it[2] == '\x9D' || it[2] == '\x9E');
+}
+
+// bytes the scanner does not accept within comments in typographic quotes, see the scanner
+static bool isCommentDelimiterByte(char c)
+{
+    switch (c) {
+        case '(':
+        case ')':
+        case '|':
+        case '"':
+        case '\xE2':
+        case '\x80':
+        case '\x9C':
+        case '\x9D':
+        case '\x9E':
+            return true;
+    }
+    return false;
+}
+
+/** Copy @p begin to @p end to @p out, replacing the characters listed in unicode_folds
+ *  by their ASCII counterparts. This keeps those out of the scanner DFA, and lets mostly ASCII
+ *  input pass through in large blocks.
+ *  Comments are copied unchanged, as are any parts of the input where we cannot tell
+ *  for sure whether they are comments.
+ *  @returns The size of the result, which is never larger than the input.
+ */
+static std::size_t foldInput(const char *begin, const char *end, char *out)
+{
+    const auto outBegin = out;
+    auto it = begin;
+    while (it != end) {
+        const auto next = std::find_if_not(it, end, isAsciiOrQuote);
+        out = std::copy(it, next, out);
+        it = next;
+        if (it == end) {
+            break;
+        }
+
+        if (*it == '"') {
+            const auto commentEnd = std::find(it + 1, end, '"');
+            it = commentEnd == end ? end : commentEnd + 1;
+            out = std::copy(next, it, out);
+            continue;
+        }
+        // typographic quotes can end in a number of ways, see the scanner
+        if (isTypographicQuote(it, end)) {
+            const auto commentEnd = std::find_if(it + 3, end, isCommentDelimiterByte);
+            if (commentEnd != end && (*commentEnd == '"' || isTypographicQuote(commentEnd, end))) {
+                it = commentEnd + (*commentEnd == '"' ? 1 : 3);
+                out = std::copy(next, it, out);
+                continue;
+            }
+            // not a comment the scanner recognizes, leave everything else as-is
+            out = std::copy(it, end, out);
+            break;
+        }
+
+        if (const auto fold = findUnicodeFold(it, end)) {
+            *out++ = fold->ascii;
+            it += fold->utf8 > 0xFFFF ? 3 : 2;
+        } else {
+            *out++ = *it++;
+        }
+    }
+    return out - outBegin;
+}
+
+/** Flex scanner state and input buffer, reused across parser runs.
+ *  Setting those up for every expression is noticeable when processing many expressions,
+ *  so there is one instance per thread.
+ */
+class ParserContext
+{
+public:
+    ParserContext()
+    {
+        if (yylex_init(&m_scanner)) {
+            m_scanner = nullptr;
+        }
+    }
+    ~ParserContext()
+    {
+        if (m_scanner) {
+            yylex_destroy(m_scanner);
+        }
+    }
+    ParserContext(const ParserContext&) = delete;
+    ParserContext& operator=(const ParserContext&) = delete;
+
+    static ParserContext& instance()
+    {
+        static thread_local ParserContext s_context;
+        return s_context;
+    }
+
+    yyscan_t scanner() const { return m_scanner; }
+
+    /** Set up the scanner for @p size bytes at @p data.
+     *  This copies the input into our own buffer, as flex needs two trailing null bytes
+     *  and modifies the buffer while scanning. Unicode variants of some characters are
+     *  folded to ASCII while doing that, see foldInput().
+     *  @returns The size of the scanned input, positions reported by the scanner refer to that.
+     */
+    std::size_t beginScan(const char *data, std::size_t size)
+    {
+        m_buffer.resize(size + 2);
+        const auto scanSize = foldInput(data, data + size, m_buffer.data());
+        m_buffer.resize(scanSize + 2);
+        m_buffer[scanSize] = m_buffer[scanSize + 1] = '\0';
+        // folding always shrinks the input, so it only needs to be retained if the size changed
+        if (scanSize == size) {
+            m_input = data;
+        } else {
+            m_folded.assign(m_buffer.begin(), m_buffer.begin() + scanSize);
+            m_input = m_folded.data();
+        }
+        scanFrom(0);
+        return scanSize;
+    }
+
+    /** Continue scanning at @p offset into the input, after an aborted parser run.
+     *  This reuses the already copied input, so the cost of error recovery does not
+     *  depend on the size of the remaining input.
+     */
+    void restartScan(std::size_t offset)
+    {
+        // flex replaces the character following the last token with a null byte, restore that
+        const auto held = yyget_text(m_scanner) + yyget_leng(m_scanner);
+        if (held >= m_buffer.data() && held < m_buffer.data() + m_buffer.size() - 2) {
+            *held = m_input[held - m_buffer.data()];
+        }
+        endScan();
+        scanFrom(offset);
+    }
+
+    void endScan()
+    {
+        yy_delete_buffer(m_state, m_scanner);
+        m_state = nullptr;
+    }
+
+private:
+    void scanFrom(std::size_t offset)
+    {
+        m_state = yy_scan_buffer(m_buffer.data() + offset, m_buffer.size() - offset, m_scanner);
+        yyset_lineno(1, m_scanner);
+    }
+
+    yyscan_t m_scanner = nullptr;
+    YY_BUFFER_STATE m_state = nullptr;
+    std::vector<char> m_buffer;
+    std::vector<char> m_folded;
+    const char *m_input = nullptr;
+};
+}
+
+/** Parse @p openingHours with the full parser, including error recovery.
+ *  @returns @c false on unrecoverable syntax errors.
+ */
+static bool parseFull(OpeningHoursPrivate *d, const char *openingHours, std::size_t size)
+{
+    auto &context = ParserContext::instance();
+    const auto scanner = context.scanner();
+    if (!scanner) {
+        qCWarning(Log) << "Failed to initialize scanner?!";
+        d->m_error = OpeningHours::SyntaxError;
+        return false;
+    }
+
+    // error recovery continues parsing from the error position, with the rules found so far retained
+    d->m_restartPosition = 0;
+    const auto scanSize = context.beginScan(openingHours, size);
+    int offset = 0;
+    bool success = true;
+    do {
+        const auto parseResult = yyparse(d, scanner);
+        if (parseResult) {
+            if (d->m_restartPosition > 1 && d->m_restartPosition + offset < (int)scanSize) {
+                offset += d->m_restartPosition - 1;
+                d->m_initialRuleType = d->m_recoveryRuleType;
+                d->m_recoveryRuleType = Rule::NormalRule;
+                d->m_restartPosition = 0;
+                context.restartScan(offset);
+            } else {
+                d->m_error = OpeningHours::SyntaxError;
+                success = false;
+                break;
+            }
+            d->m_error = OpeningHours::NoError;
+        } else {
+            if (d->m_error != OpeningHours::SyntaxError) {
+                d->m_error = OpeningHours::NoError;
+            }
+            offset = -1;
+        }
+    } while (offset > 0);
+    context.endScan();
+    return success;
+}
+
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+/** UTF-8 representation of @p str.
+ *  This uses a buffer per thread rather than a new QByteArray for each call,
+ *  so parsing UTF-16 input doesn't need any allocations for the conversion.
+ */
+static const std::vector<char>& toUtf8(QStringView str)
+{
+    static thread_local std::vector<char> s_buffer;
+    s_buffer.resize(Utf8::maximumSize(str.size()));
+    const auto end = Utf8::encode(str.data(), str.data() + str.size(), s_buffer.data());
+    s_buffer.resize(end - s_buffer.data());
+    return s_buffer;
+}
+#endif
+
+/** Size of @p expression without trailing spaces.
+ *  The parser would handle most of this by itself, but fails if a trailing space would produce a trailing rule separator.
+ *  So it's easier to just clean this here.
+ */
+static std::size_t trimmedSize(const char *expression, std::size_t size)
+{
+    while (size > 0 && std::isspace(static_cast<unsigned char>(expression[size - 1]))) {
+        --size;
+    }
+    return size;
+}
+
 static bool isWiderThan(Rule *lhs, Rule *rhs)
 {
-    if ((lhs->m_yearSelector && !rhs->m_yearSelector)) {
+    if ((!lhs->m_yearSelectors.empty() && rhs->m_yearSelectors.empty())) {
         return true;
     }
-    if (lhs->m_monthdaySelector && rhs->m_monthdaySelector) {
-        if (lhs->m_monthdaySelector->begin.year > 0 && rhs->m_monthdaySelector->end.year == 0) {
+    if (!lhs->m_monthdaySelectors.empty() && !rhs->m_monthdaySelectors.empty()) {
+        if (lhs->m_monthdaySelectors.front().begin.year > 0 && rhs->m_monthdaySelectors.front().end.year == 0) {
             return true;
         }
     }
@@ -37,6 +357,34 @@ static bool isWiderThan(Rule *lhs, Rule *rhs)
     return false;
 }
 
+/** Calls @p merge on each pair of adjacent rules, and drops the second rule of the pair if that returns @c true.
+ *  The rule kept is then passed again as the first rule of the next pair.
+ *  This compacts @p rules in a single pass, rather than erasing from the middle of the vector for each merged rule.
+ */
+template <typename MergeFunc>
+static void mergeAdjacentRules(std::vector<std::shared_ptr<Rule>> &rules, MergeFunc merge)
+{
+    auto prevIt = rules.begin();
+    for (auto it = std::next(prevIt); it != rules.end(); ++it) {
+        if (merge(*prevIt, *it)) {
+            continue;
+        }
+        ++prevIt;
+        if (prevIt != it) {
+            *prevIt = std::move(*it);
+        }
+    }
+    rules.erase(std::next(prevIt), rules.end());
+}
+
+/** Moves all selectors in @p selectors to the end of @p list. */
+template <typename T>
+static void appendSelectors(std::vector<T> &list, std::vector<T> &&selectors)
+{
+    list.insert(list.end(), selectors.begin(), selectors.end());
+    selectors.clear();
+}
+
 void OpeningHoursPrivate::autocorrect()
 {
     if (m_rules.size() <= 1 || m_error == OpeningHours::SyntaxError) {
@@ -48,12 +396,13 @@ void OpeningHoursPrivate::autocorrect()
     // this matters as those two variants have widely varying semantics, and often occur technically wrong in the wild
     // the other case is "Mo-Fr 06:30-12:00, 13:00-18:00", which should become "Mo-Fr 06:30-12:00,13:00-18:00"
 
-    for (auto it = std::next(m_rules.begin()); it != m_rules.end(); ++it) {
-        auto rule = (*it).get();
-        auto prevRule = (*(std::prev(it))).get();
+    SelectorAppender<WeekdayRange> weekdayAppender;
+    mergeAdjacentRules(m_rules, [&](std::shared_ptr<Rule> &prevSlot, std::shared_ptr<Rule> &slot) {
+        auto rule = slot.get();
+        auto prevRule = prevSlot.get();
 
         if (rule->hasComment() || prevRule->hasComment() || !prevRule->hasImplicitState()) {
-            continue;
+            return false;
         }
         const auto prevRuleSingleSelector = prevRule->selectorCount() == 1;
         const auto curRuleSingleSelector = rule->selectorCount() == 1;
@@ -61,62 +410,62 @@ void OpeningHoursPrivate::autocorrect()
         if (rule->m_ruleType == Rule::AdditionalRule) {
             // the previous rule has no time selector, the current rule only has a weekday selector.
             // so we fold the two rules together
-            if (!prevRule->m_timeSelector && prevRule->m_weekdaySelector && rule->m_weekdaySelector && !rule->hasWideRangeSelector()) {
+            if (prevRule->m_timeSelectors.empty() && prevRule->m_weekdaySelector && rule->m_weekdaySelector && !rule->hasWideRangeSelector()) {
                 auto tmp = std::move(rule->m_weekdaySelector);
                 rule->m_weekdaySelector = std::move(prevRule->m_weekdaySelector);
-                rule->m_weekSelector = std::move(prevRule->m_weekSelector);
-                rule->m_monthdaySelector = std::move(prevRule->m_monthdaySelector);
-                rule->m_yearSelector = std::move(prevRule->m_yearSelector);
+                rule->m_weekSelectors = std::move(prevRule->m_weekSelectors);
+                rule->m_monthdaySelectors = std::move(prevRule->m_monthdaySelectors);
+                rule->m_yearSelectors = std::move(prevRule->m_yearSelectors);
                 rule->m_colonAfterWideRangeSelector = prevRule->m_colonAfterWideRangeSelector;
                 auto *selector = rule->m_weekdaySelector.get();
                 while (selector->rhsAndSelector)
                     selector = selector->rhsAndSelector.get();
-                appendSelector(selector, std::move(tmp));
+                weekdayAppender.append(selector, std::move(tmp));
                 rule->m_ruleType = prevRule->m_ruleType;
-                std::swap(*it, *std::prev(it));
-                it = std::prev(m_rules.erase(it));
+                std::swap(slot, prevSlot);
+                return true;
             }
 
             // the current rule only has a time selector, so we append that to the previous rule
-            else if (curRuleSingleSelector && rule->m_timeSelector && prevRule->m_timeSelector) {
-                appendSelector(prevRule->m_timeSelector.get(), std::move(rule->m_timeSelector));
+            else if (curRuleSingleSelector && !rule->m_timeSelectors.empty() && !prevRule->m_timeSelectors.empty()) {
+                appendSelectors(prevRule->m_timeSelectors, std::move(rule->m_timeSelectors));
                 prevRule->copyStateFrom(*rule);
-                it = std::prev(m_rules.erase(it));
+                return true;
             }
 
             // previous is a single weekday selector and current is a single time selector
-            else if (curRuleSingleSelector && prevRuleSingleSelector && rule->m_timeSelector && prevRule->m_weekdaySelector) {
-                prevRule->m_timeSelector = std::move(rule->m_timeSelector);
-                it = std::prev(m_rules.erase(it));
+            else if (curRuleSingleSelector && prevRuleSingleSelector && !rule->m_timeSelectors.empty() && prevRule->m_weekdaySelector) {
+                prevRule->m_timeSelectors = std::move(rule->m_timeSelectors);
+                return true;
             }
 
             // previous is a single monthday selector
-            else if (rule->m_monthdaySelector && prevRuleSingleSelector && prevRule->m_monthdaySelector && !isWiderThan(prevRule, rule)) {
-                auto tmp = std::move(rule->m_monthdaySelector);
-                rule->m_monthdaySelector = std::move(prevRule->m_monthdaySelector);
-                appendSelector(rule->m_monthdaySelector.get(), std::move(tmp));
+            else if (!rule->m_monthdaySelectors.empty() && prevRuleSingleSelector && !prevRule->m_monthdaySelectors.empty() && !isWiderThan(prevRule, rule)) {
+                appendSelectors(prevRule->m_monthdaySelectors, std::move(rule->m_monthdaySelectors));
+                rule->m_monthdaySelectors = std::move(prevRule->m_monthdaySelectors);
                 rule->m_ruleType = prevRule->m_ruleType;
-                std::swap(*it, *std::prev(it));
-                it = std::prev(m_rules.erase(it));
+                std::swap(slot, prevSlot);
+                return true;
             }
 
             // previous has no time selector and the current one is a misplaced 24/7 rule:
             // convert the 24/7 to a 00:00-24:00 time selector
-            else if (rule->selectorCount() == 0 && rule->m_seen_24_7 && !prevRule->m_timeSelector) {
-                prevRule->m_timeSelector.reset(new Timespan);
-                prevRule->m_timeSelector->begin = { Time::NoEvent, 0, 0 };
-                prevRule->m_timeSelector->end = { Time::NoEvent, 24, 0 };
-                it = std::prev(m_rules.erase(it));
+            else if (rule->selectorCount() == 0 && rule->m_seen_24_7 && prevRule->m_timeSelectors.empty()) {
+                Timespan span;
+                span.begin = { Time::NoEvent, 0, 0 };
+                span.end = { Time::NoEvent, 24, 0 };
+                prevRule->m_timeSelectors.push_back(span);
+                return true;
             }
         } else if (rule->m_ruleType == Rule::NormalRule) {
             // Previous rule has time and other selectors
             // Current rule is only a time selector
             // "Mo-Sa 12:00-15:00; 18:00-24:00" => "Mo-Sa 12:00-15:00,18:00-24:00"
-            if (curRuleSingleSelector && rule->m_timeSelector
-                    && prevRule->selectorCount() > 1 && prevRule->m_timeSelector
+            if (curRuleSingleSelector && !rule->m_timeSelectors.empty()
+                    && prevRule->selectorCount() > 1 && !prevRule->m_timeSelectors.empty()
                     && rule->state() == prevRule->state()) {
-                appendSelector(prevRule->m_timeSelector.get(), std::move(rule->m_timeSelector));
-                it = std::prev(m_rules.erase(it));
+                appendSelectors(prevRule->m_timeSelectors, std::move(rule->m_timeSelectors));
+                return true;
             }
 
             // Both rules have exactly the same selector apart from time
@@ -124,18 +473,105 @@ void OpeningHoursPrivate::autocorrect()
             // Obviously a bug, it was overwriting the 12:00-15:00 range.
             // For now this only supports weekday selectors, could be extended
             else if (rule->selectorCount() == prevRule->selectorCount()
-                     && rule->m_timeSelector && prevRule->m_timeSelector
+                     && !rule->m_timeSelectors.empty() && !prevRule->m_timeSelectors.empty()
                      && !rule->hasComment() && !prevRule->hasComment()
                      && rule->selectorCount() == 2 && rule->m_weekdaySelector && prevRule->m_weekdaySelector
-                     // slower than writing an operator==, but so much easier to write :)
-                     && rule->m_weekdaySelector->toExpression() == prevRule->m_weekdaySelector->toExpression()
+                     && *rule->m_weekdaySelector == *prevRule->m_weekdaySelector
                      && rule->state() == prevRule->state()
                      ) {
-                appendSelector(prevRule->m_timeSelector.get(), std::move(rule->m_timeSelector));
-                it = std::prev(m_rules.erase(it));
+                appendSelectors(prevRule->m_timeSelectors, std::move(rule->m_timeSelectors));
+                return true;
             }
         }
+        return false;
+    });
+}
+
+/** Days of the week covered by @p rule, as a bitmask with Mo=1, Tu=2, ..., Su=64.
+ *  This is 0 for anything that isn't a normal rule consisting only of a time selector and a list of plain weekday ranges.
+ */
+static uint8_t weeklyRuleDays(const Rule *rule)
+{
+    if (rule->m_ruleType != Rule::NormalRule || rule->hasComment() || rule->hasWideRangeSelector() || rule->m_timeSelectors.empty() || !rule->m_weekdaySelector) {
+        return 0;
+    }
+    // time spans reaching into the following day would need that day in the mask as well
+    for (const auto &span : rule->m_timeSelectors) {
+        if (span.pointInTime) {
+            continue;
+        }
+        if (span.openEnd || span.begin.event != Time::NoEvent || span.end.event != Time::NoEvent) {
+            return 0;
+        }
+        const auto begin = span.begin.hour * 60 + span.begin.minute;
+        const auto end = span.end.hour * 60 + span.end.minute;
+        if (end <= begin || end >= 24 * 60) {
+            return 0;
+        }
     }
+    uint8_t days = 0;
+    for (auto selector = rule->m_weekdaySelector.get(); selector; selector = selector->next.get()) {
+        if (selector->nthSequence || selector->lhsAndSelector || selector->holiday != WeekdayRange::NoHoliday || selector->offset) {
+            return 0;
+        }
+        const bool wrap = selector->beginDay > selector->endDay;
+        for (int day = selector->beginDay; day <= selector->endDay + (wrap ? 7 : 0); ++day) {
+            days |= 1 << ((day - 1) % 7);
+        }
+    }
+    return days;
+}
+
+/** Merge weekly rules with the same time selector and state that aren't adjacent,
+ *  as long as none of the rules in between applies to any of the same days.
+ *  Mo 08:00-12:00; Sa 10:00-14:00; Tu 08:00-12:00 => Mo,Tu 08:00-12:00; Sa 10:00-14:00
+ */
+static void mergeWeeklyRules(std::vector<std::shared_ptr<Rule>> &rules)
+{
+    struct Group {
+        Rule *rule;
+        uint8_t laterDays; // days covered by any rule following this one
+    };
+    std::vector<Group> groups;
+    std::unordered_multimap<std::size_t, std::size_t> groupsByTime;
+    SelectorAppender<WeekdayRange> weekdayAppender;
+
+    std::vector<std::shared_ptr<Rule>> result;
+    result.reserve(rules.size());
+    for (auto &rule : rules) {
+        const auto days = weeklyRuleDays(rule.get());
+        if (!days) {
+            groups.clear();
+            groupsByTime.clear();
+            result.push_back(std::move(rule));
+            continue;
+        }
+
+        const auto timeHash = qHash(rule->m_timeSelectors);
+        const auto range = groupsByTime.equal_range(timeHash);
+        const auto it = std::find_if(range.first, range.second, [&](const auto &entry) {
+            const auto &group = groups[entry.second];
+            return (group.laterDays & days) == 0
+                && group.rule->m_timeSelectors == rule->m_timeSelectors
+                && group.rule->state() == rule->state();
+        });
+        if (it != range.second) {
+            const auto groupIdx = it->second;
+            weekdayAppender.append(groups[groupIdx].rule->m_weekdaySelector.get(), std::move(rule->m_weekdaySelector));
+            for (std::size_t i = 0; i < groupIdx; ++i) {
+                groups[i].laterDays |= days;
+            }
+            continue;
+        }
+
+        for (auto &group : groups) {
+            group.laterDays |= days;
+        }
+        groupsByTime.emplace(timeHash, groups.size());
+        groups.push_back({ rule.get(), 0 });
+        result.push_back(std::move(rule));
+    }
+    rules = std::move(result);
 }
 
 void OpeningHoursPrivate::simplify()
@@ -144,9 +580,10 @@ void OpeningHoursPrivate::simplify()
         return;
     }
 
-    for (auto it = std::next(m_rules.begin()); it != m_rules.end(); ++it) {
-        auto rule = (*it).get();
-        auto prevRule = (*(std::prev(it))).get();
+    SelectorAppender<WeekdayRange> weekdayAppender;
+    mergeAdjacentRules(m_rules, [&](std::shared_ptr<Rule> &prevSlot, std::shared_ptr<Rule> &slot) {
+        auto rule = slot.get();
+        auto prevRule = prevSlot.get();
 
         if (rule->m_ruleType == Rule::AdditionalRule || rule->m_ruleType == Rule::NormalRule) {
 
@@ -157,16 +594,15 @@ void OpeningHoursPrivate::simplify()
             // Both rules have the same time and a different weekday selector
             // Mo 08:00-13:00; Tu 08:00-13:00 => Mo,Tu 08:00-13:00
             if (rule->selectorCount() == prevRule->selectorCount()
-                    && rule->m_timeSelector && prevRule->m_timeSelector
+                    && !rule->m_timeSelectors.empty() && !prevRule->m_timeSelectors.empty()
                     && rule->selectorCount() == 2 && rule->m_weekdaySelector && prevRule->m_weekdaySelector
                     && hasNoHoliday(rule->m_weekdaySelector.get())
                     && hasNoHoliday(prevRule->m_weekdaySelector.get())
-                    && *rule->m_timeSelector == *prevRule->m_timeSelector
+                    && rule->m_timeSelectors == prevRule->m_timeSelectors
                     ) {
                 // We could of course also turn Mo,Tu,We,Th into Mo-Th...
-                appendSelector(prevRule->m_weekdaySelector.get(), std::move(rule->m_weekdaySelector));
-                it = std::prev(m_rules.erase(it));
-                continue;
+                weekdayAppender.append(prevRule->m_weekdaySelector.get(), std::move(rule->m_weekdaySelector));
+                return true;
             }
         }
 
@@ -175,17 +611,18 @@ void OpeningHoursPrivate::simplify()
             // Ex: "Mo 12:00-15:00, Mo 18:00-24:00" => "Mo 12:00-15:00,18:00-24:00"
             // For now this only supports weekday selectors, could be extended
             if (rule->selectorCount() == prevRule->selectorCount()
-                    && rule->m_timeSelector && prevRule->m_timeSelector
+                    && !rule->m_timeSelectors.empty() && !prevRule->m_timeSelectors.empty()
                     && !rule->hasComment() && !prevRule->hasComment()
                     && rule->selectorCount() == 2 && rule->m_weekdaySelector && prevRule->m_weekdaySelector
-                    // slower than writing an operator==, but so much easier to write :)
-                    && rule->m_weekdaySelector->toExpression() == prevRule->m_weekdaySelector->toExpression()
+                    && *rule->m_weekdaySelector == *prevRule->m_weekdaySelector
                     ) {
-                appendSelector(prevRule->m_timeSelector.get(), std::move(rule->m_timeSelector));
-                it = std::prev(m_rules.erase(it));
+                appendSelectors(prevRule->m_timeSelectors, std::move(rule->m_timeSelectors));
+                return true;
             }
         }
-    }
+        return false;
+    });
+    mergeWeeklyRules(m_rules);
 
     // Now try collapsing adjacent week days: Mo,Tu,We => Mo-We
     for (auto it = m_rules.begin(); it != m_rules.end(); ++it) {
@@ -193,12 +630,52 @@ void OpeningHoursPrivate::simplify()
         if (rule->m_weekdaySelector) {
             rule->m_weekdaySelector->simplify();
         }
-        if (rule->m_monthdaySelector) {
-            rule->m_monthdaySelector->simplify();
+        if (!rule->m_monthdaySelectors.empty()) {
+            rule->m_monthdaySelectors.front().simplify();
+        }
+    }
+}
+
+void OpeningHoursPrivate::detachRules()
+{
+    for (auto &rule : m_rules) {
+        if (rule.use_count() > 1) {
+            rule = rule->clone();
         }
     }
 }
 
+void OpeningHoursPrivate::compactRules()
+{
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+    m_weeklyEvaluator = WeeklyEvaluator::compile(m_rules);
+#endif
+}
+
+/** Error state for an expression requiring capabilities @p c. */
+static OpeningHours::Error validateCapabilities(int c, OpeningHours::Modes modes, bool hasLocation, bool hasRegion)
+{
+    if ((c & Capability::Location) && !hasLocation) {
+        return OpeningHours::MissingLocation;
+    }
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+    if (c & Capability::PublicHoliday && !hasRegion) {
+        return OpeningHours::MissingRegion;
+    }
+#else
+    Q_UNUSED(hasRegion);
+#endif
+    if (((c & Capability::PointInTime) && (modes & OpeningHours::PointInTimeMode) == 0)
+     || ((c & Capability::Interval) && (modes & OpeningHours::IntervalMode) == 0)) {
+        return OpeningHours::IncompatibleMode;
+    }
+    if (c & (Capability::SchoolHoliday | Capability::NotImplemented | Capability::PointInTime)) {
+        return OpeningHours::UnsupportedFeature;
+    }
+
+    return OpeningHours::NoError;
+}
+
 void OpeningHoursPrivate::validate()
 {
     if (m_error == OpeningHours::SyntaxError) {
@@ -214,27 +691,13 @@ void OpeningHoursPrivate::validate()
         c |= rule->requiredCapabilities();
     }
 
-    if ((c & Capability::Location) && (std::isnan(m_latitude) || std::isnan(m_longitude))) {
-        m_error = OpeningHours::MissingLocation;
-        return;
-    }
+    const auto hasLocation = !std::isnan(m_latitude) && !std::isnan(m_longitude);
 #ifndef KOPENINGHOURS_VALIDATOR_ONLY
-    if (c & Capability::PublicHoliday && !m_region.isValid()) {
-        m_error = OpeningHours::MissingRegion;
-        return;
-    }
+    const auto hasRegion = m_region.isValid();
+#else
+    const auto hasRegion = false;
 #endif
-    if (((c & Capability::PointInTime) && (m_modes & OpeningHours::PointInTimeMode) == 0)
-     || ((c & Capability::Interval) && (m_modes & OpeningHours::IntervalMode) == 0)) {
-        m_error = OpeningHours::IncompatibleMode;
-        return;
-    }
-    if (c & (Capability::SchoolHoliday | Capability::NotImplemented | Capability::PointInTime)) {
-        m_error = OpeningHours::UnsupportedFeature;
-        return;
-    }
-
-    m_error = OpeningHours::NoError;
+    m_error = validateCapabilities(c, m_modes, hasLocation, hasRegion);
 }
 
 void OpeningHoursPrivate::addRule(Rule *parsedRule)
@@ -256,8 +719,8 @@ void OpeningHoursPrivate::addRule(Rule *parsedRule)
     if (m_ruleSeparatorRecovery && !m_rules.empty()) {
         if (rule->selectorCount() <= 1) {
             // missing separator was actually between time selectors, not rules
-            if (m_rules.back()->m_timeSelector && rule->m_timeSelector && m_rules.back()->state() == rule->state()) {
-                appendSelector(m_rules.back()->m_timeSelector.get(), std::move(rule->m_timeSelector));
+            if (!m_rules.back()->m_timeSelectors.empty() && !rule->m_timeSelectors.empty() && m_rules.back()->state() == rule->state()) {
+                appendSelectors(m_rules.back()->m_timeSelectors, std::move(rule->m_timeSelectors));
                 rule.reset();
                 return;
             } else {
@@ -329,6 +792,13 @@ OpeningHours::OpeningHours(const char *openingHours, std::size_t size, Modes mod
     setExpression(openingHours, size, modes);
 }
 
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+OpeningHours::OpeningHours(QStringView openingHours, Modes modes)
+    : d(new OpeningHoursPrivate)
+{
+    setExpression(openingHours, modes);
+}
+#endif
 
 OpeningHours::OpeningHours(const OpeningHours&) = default;
 OpeningHours::OpeningHours(OpeningHours&&) = default;
@@ -342,100 +812,286 @@ void OpeningHours::setExpression(const QByteArray &openingHours, OpeningHours::M
     setExpression(openingHours.constData(), openingHours.size(), modes);
 }
 
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+void OpeningHours::setExpression(QStringView openingHours, Modes modes)
+{
+    const auto &utf8 = toUtf8(openingHours);
+    setExpression(utf8.data(), utf8.size(), modes);
+}
+#endif
+
 void OpeningHours::setExpression(const char *openingHours, std::size_t size, Modes modes)
 {
     d->m_modes = modes;
+    d->m_deferred = false;
+    d->m_deferredExpression.clear();
+    d->parse(openingHours, size);
+}
 
-    d->m_error = OpeningHours::Null;
-    d->m_rules.clear();
-    d->m_initialRuleType = Rule::NormalRule;
-    d->m_recoveryRuleType = Rule::NormalRule;
-    d->m_ruleSeparatorRecovery = false;
-
-    // trim trailing spaces
-    // the parser would handle most of this by itself, but fails if a trailing space would produce a trailing rule separator.
-    // so it's easier to just clean this here.
-    while (size > 0 && std::isspace(static_cast<unsigned char>(openingHours[size - 1]))) {
-        --size;
+OpeningHours OpeningHours::deferred(const QByteArray &openingHours, Modes modes)
+{
+    OpeningHours oh;
+    oh.d->m_modes = modes;
+    oh.d->m_deferredExpression = openingHours;
+    oh.d->m_deferred = true;
+    return oh;
+}
+
+void OpeningHoursPrivate::parse(const char *openingHours, std::size_t size)
+{
+    m_error = OpeningHours::Null;
+    m_rules.clear();
+    m_arena.reset();
+
+    size = trimmedSize(openingHours, size);
+    if (size == 0 || !appendRules(openingHours, size)) {
+        return;
     }
-    if (size == 0) {
+
+    autocorrect();
+    compactRules();
+    validate();
+}
+
+bool OpeningHoursPrivate::appendRules(const char *openingHours, std::size_t size)
+{
+    m_initialRuleType = Rule::NormalRule;
+    m_recoveryRuleType = Rule::NormalRule;
+    m_ruleSeparatorRecovery = false;
+
+    if (!m_arena) {
+        m_arena = std::make_shared<Arena>(size);
+    }
+    ArenaScope arenaScope(m_arena.get());
+
+    // most expressions in practice are already in canonical form, those don't need the full parser
+    if (isFastPathEnabled(FastPath::CanonicalParser) && CanonicalParser(openingHours, size).parse(this)) {
+        m_error = OpeningHours::NoError;
+        return true;
+    }
+    return parseFull(this, openingHours, size);
+}
+
+void OpeningHoursPrivate::ensureParsed()
+{
+    if (!m_deferred.load(std::memory_order_acquire)) {
         return;
     }
 
-    d->m_restartPosition = 0;
-    int offset = 0;
-    do {
-        yyscan_t scanner;
-        if (yylex_init(&scanner)) {
-            qCWarning(Log) << "Failed to initialize scanner?!";
-            d->m_error = SyntaxError;
-            return;
-        }
-        const std::unique_ptr<void, decltype(&yylex_destroy)> lexerCleanup(scanner, &yylex_destroy);
-
-        YY_BUFFER_STATE state;
-        state = yy_scan_bytes(openingHours + offset, size - offset, scanner);
-        if (yyparse(d.data(), scanner)) {
-            if (d->m_restartPosition > 1 && d->m_restartPosition + offset < (int)size) {
-                offset += d->m_restartPosition - 1;
-                d->m_initialRuleType = d->m_recoveryRuleType;
-                d->m_recoveryRuleType = Rule::NormalRule;
-                d->m_restartPosition = 0;
-            } else {
-                d->m_error = SyntaxError;
+    QMutexLocker locker(&m_deferredMutex);
+    if (m_deferred.load(std::memory_order_relaxed)) {
+        parse(m_deferredExpression.constData(), m_deferredExpression.size());
+        m_deferredExpression.clear();
+        m_deferred.store(false, std::memory_order_release);
+    }
+}
+
+void OpeningHoursPrivate::revalidate()
+{
+    if (!m_deferred.load(std::memory_order_acquire)) {
+        validate();
+    }
+}
+
+OpeningHours::Error OpeningHours::check(const QByteArray &openingHours, Modes modes)
+{
+    return check(openingHours.constData(), openingHours.size(), modes);
+}
+
+OpeningHours::Error OpeningHours::check(const char *openingHours, std::size_t size, Modes modes)
+{
+    size = trimmedSize(openingHours, size);
+    if (size == 0) {
+        return Null;
+    }
+
+    CanonicalParser parser(openingHours, size);
+    if (isFastPathEnabled(FastPath::CanonicalParser) && parser.parse(nullptr)) {
+        return validateCapabilities(parser.capabilities(), modes, false, false);
+    }
+    return OpeningHours(openingHours, size, modes).error();
+}
+
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+OpeningHours::Error OpeningHours::check(QStringView openingHours, Modes modes)
+{
+    const auto &utf8 = toUtf8(openingHours);
+    return check(utf8.data(), utf8.size(), modes);
+}
+#endif
+
+namespace {
+/** Runs one parallelFor() worker on a thread of the global thread pool. */
+class ParallelForRunnable : public QRunnable
+{
+public:
+    explicit ParallelForRunnable(const std::function<void()> &worker, QSemaphore *done)
+        : m_worker(worker)
+        , m_done(done)
+    {
+    }
+    void run() override
+    {
+        m_worker();
+        m_done->release();
+    }
+
+private:
+    std::function<void()> m_worker;
+    QSemaphore *m_done;
+};
+}
+
+/** Calls @p func for all indexes in [0, @p count), distributed over all available cores.
+ *  This uses the threads of the global thread pool rather than starting new ones, so the
+ *  per-thread parser state survives between calls.
+ */
+template <typename Func>
+static void parallelFor(std::size_t count, Func func)
+{
+    // indexes are handed out to the worker threads in chunks of this size, small enough
+    // to balance the load, large enough to not contend on the shared counter
+    constexpr std::size_t ChunkSize = 64;
+
+    std::atomic<std::size_t> nextChunk(0);
+    const std::function<void()> worker = [&]() {
+        for (;;) {
+            const auto begin = nextChunk.fetch_add(ChunkSize, std::memory_order_relaxed);
+            if (begin >= count) {
                 return;
             }
-            d->m_error = NoError;
-        } else {
-            if (d->m_error != SyntaxError) {
-                d->m_error = NoError;
+            const auto end = std::min(begin + ChunkSize, count);
+            for (auto i = begin; i < end; ++i) {
+                func(i);
             }
-            offset = -1;
         }
+    };
+
+    // only use pool threads that are idle right now, the calling thread does the remaining work
+    // on its own, so this neither waits for unrelated work in the pool nor deadlocks when called
+    // from a pool thread itself
+    const std::size_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+    auto pool = QThreadPool::globalInstance();
+    const auto threadCount = std::min<std::size_t>(std::max(1, pool->maxThreadCount()), chunkCount);
+    QSemaphore done;
+    int started = 0;
+    for (std::size_t i = 1; i < threadCount; ++i) {
+        auto runnable = new ParallelForRunnable(worker, &done);
+        if (!pool->tryStart(runnable)) {
+            delete runnable;
+            break;
+        }
+        ++started;
+    }
+    worker();
+    done.acquire(started);
+}
 
-        yy_delete_buffer(state, scanner);
-    } while (offset > 0);
+std::vector<OpeningHours> OpeningHours::parseBatch(const std::vector<QByteArray> &expressions, Modes modes)
+{
+    std::vector<OpeningHours> result(expressions.size());
+    parallelFor(expressions.size(), [&](std::size_t i) {
+        result[i].setExpression(expressions[i], modes);
+    });
+    return result;
+}
 
-    d->autocorrect();
-    d->validate();
+QByteArray OpeningHours::serialize() const
+{
+    d->ensureParsed();
+    if (d->m_error == Null || d->m_error == SyntaxError) {
+        return {};
+    }
+    QByteArray data;
+    BinaryFormat::write(d.data(), data);
+    return data;
+}
+
+OpeningHours OpeningHours::deserialize(const char *data, std::size_t size)
+{
+    OpeningHours oh;
+    if (size == 0) {
+        return oh;
+    }
+    if (!BinaryFormat::read(data, size, oh.d.data())) {
+        qCWarning(Log) << "Invalid binary opening hours data";
+        oh.d->m_error = SyntaxError;
+        return oh;
+    }
+    oh.d->m_error = NoError;
+    oh.d->compactRules();
+    oh.d->validate();
+    return oh;
+}
+
+OpeningHours OpeningHours::deserialize(const QByteArray &data)
+{
+    return deserialize(data.constData(), data.size());
 }
 
 QByteArray OpeningHours::normalizedExpression() const
 {
+    d->ensureParsed();
     if (d->m_error == SyntaxError) {
         return {};
     }
 
-    QByteArray ret;
+    // serialize into a per-thread buffer that retains its capacity, so that the only
+    // allocation needed here in the common case is the one for the result
+    static thread_local QByteArray s_buffer;
+    if (s_buffer.capacity() == 0) {
+        s_buffer.reserve(256);
+    }
+    s_buffer.resize(0);
     for (const auto &rule : d->m_rules) {
-        if (!ret.isEmpty()) {
+        if (!s_buffer.isEmpty()) {
             switch (rule->m_ruleType) {
                 case Rule::NormalRule:
-                    ret += "; ";
+                    s_buffer += "; ";
                     break;
                 case Rule::AdditionalRule:
-                    ret += ", ";
+                    s_buffer += ", ";
                     break;
                 case Rule::FallbackRule:
-                    ret += " || ";
+                    s_buffer += " || ";
                     break;
                 case Rule::GuessRuleType:
                     Q_UNREACHABLE();
                     break;
             }
         }
-        ret += rule->toExpression();
+        rule->toExpression(s_buffer);
     }
-    return ret;
+    if (s_buffer.isEmpty()) {
+        return {};
+    }
+    return QByteArray(s_buffer.constData(), s_buffer.size());
 }
 
 QByteArray OpeningHours::simplifiedExpression() const
 {
-    OpeningHours copy(normalizedExpression());
+    d->ensureParsed();
+    OpeningHours copy;
+    copy.d->m_arena = d->m_arena;
+    copy.d->m_rules = d->m_rules;
+    copy.d->m_modes = d->m_modes;
+    copy.d->m_error = d->m_error;
+    copy.d->detachRules();
     copy.d->simplify();
     return copy.normalizedExpression();
 }
 
+void OpeningHours::simplify()
+{
+    d->ensureParsed();
+    if (d->m_error == SyntaxError) {
+        return;
+    }
+    d->detachRules();
+    d->simplify();
+    d->compactRules();
+}
+
 QString OpeningHours::normalizedExpressionString() const
 {
     return QString::fromUtf8(normalizedExpression());
@@ -445,7 +1101,7 @@ void OpeningHours::setLocation(float latitude, float longitude)
 {
     d->m_latitude = latitude;
     d->m_longitude = longitude;
-    d->validate();
+    d->revalidate();
 }
 
 float OpeningHours::latitude() const
@@ -456,7 +1112,7 @@ float OpeningHours::latitude() const
 void OpeningHours::setLatitude(float latitude)
 {
     d->m_latitude = latitude;
-    d->validate();
+    d->revalidate();
 }
 
 float OpeningHours::longitude() const
@@ -467,7 +1123,7 @@ float OpeningHours::longitude() const
 void OpeningHours::setLongitude(float longitude)
 {
     d->m_longitude = longitude;
-    d->validate();
+    d->revalidate();
 }
 
 #ifndef KOPENINGHOURS_VALIDATOR_ONLY
@@ -479,7 +1135,7 @@ QString OpeningHours::region() const
 void OpeningHours::setRegion(QStringView region)
 {
     d->m_region = HolidayCache::resolveRegion(region);
-    d->validate();
+    d->revalidate();
 }
 #endif
 
@@ -505,16 +1161,14 @@ void OpeningHours::setTimeZoneId(const QString &tzId)
 
 OpeningHours::Error OpeningHours::error() const
 {
+    d->ensureParsed();
     return d->m_error;
 }
 
 #ifndef KOPENINGHOURS_VALIDATOR_ONLY
-Interval OpeningHours::interval(const QDateTime &dt) const
+/** Evaluates all rules at @p dt, see OpeningHours::interval(). */
+static Interval evaluateRules(OpeningHoursPrivate *d, const QDateTime &dt)
 {
-    if (d->m_error != NoError) {
-        return {};
-    }
-
     const auto alignedTime = QDateTime(dt.date(), {dt.time().hour(), dt.time().minute()});
     Interval i;
     // first try to find the nearest open interval, and afterwards check closed rules
@@ -525,7 +1179,7 @@ Interval OpeningHours::interval(const QDateTime &dt) const
         if (i.isValid() && i.contains(dt) && rule->m_ruleType == Rule::FallbackRule) {
             continue;
         }
-        auto res = rule->nextInterval(alignedTime, d.data());
+        auto res = rule->nextInterval(alignedTime, d);
         if (!res.interval.isValid()) {
             continue;
         }
@@ -558,7 +1212,7 @@ Interval OpeningHours::interval(const QDateTime &dt) const
         if (rule->state() != Interval::Closed) {
             continue;
         }
-        const auto j = rule->nextInterval(i.begin().isValid() ? i.begin() : alignedTime, d.data()).interval;
+        const auto j = rule->nextInterval(i.begin().isValid() ? i.begin() : alignedTime, d).interval;
         if (!j.isValid() || !i.intersects(j)) {
             continue;
         }
@@ -583,6 +1237,16 @@ Interval OpeningHours::interval(const QDateTime &dt) const
         i.setBegin(closeEnd);
         i.setEnd(closeBegin);
     }
+    return i;
+}
+
+/** Evaluates the interval containing @p dt, see OpeningHours::interval(). */
+static Interval evaluateInterval(OpeningHoursPrivate *d, const QDateTime &dt)
+{
+    Interval i;
+    if (!d->m_weeklyEvaluator || !d->m_weeklyEvaluator->interval(dt, i)) {
+        i = evaluateRules(d, dt);
+    }
 
     // check if the resulting interval contains dt, otherwise create a synthetic fallback interval
     if (!i.isValid() || i.contains(dt)) {
@@ -597,24 +1261,101 @@ Interval OpeningHours::interval(const QDateTime &dt) const
     return i2;
 }
 
+/** Evaluates the interval following @p interval, see OpeningHours::nextInterval(). */
+static Interval evaluateNextInterval(OpeningHoursPrivate *d, const Interval &interval)
+{
+    if (interval.hasOpenEnd()) {
+        return {};
+    }
+
+    auto endDt = interval.end();
+    // ensure we move forward even on zero-length open-end intervals, otherwise we get stuck in a loop
+    if (interval.hasOpenEndTime() && interval.begin() == interval.end()) {
+        endDt = endDt.addSecs(3600);
+    }
+    auto i = evaluateInterval(d, endDt);
+    if (i.begin() < interval.end() && i.end() > interval.end()) {
+        i.setBegin(interval.end());
+    }
+    return i;
+}
+
+Interval OpeningHours::interval(const QDateTime &dt) const
+{
+    d->ensureParsed();
+    if (d->m_error != NoError) {
+        return {};
+    }
+    return evaluateInterval(d.data(), dt);
+}
+
 Interval OpeningHours::nextInterval(const Interval &interval) const
 {
-    if (!interval.hasOpenEnd()) {
-        auto endDt = interval.end();
-        // ensure we move forward even on zero-length open-end intervals, otherwise we get stuck in a loop
-        if (interval.hasOpenEndTime() && interval.begin() == interval.end()) {
-            endDt = endDt.addSecs(3600);
-        }
-        auto i = this->interval(endDt);
-        if (i.begin() < interval.end() && i.end() > interval.end()) {
-            i.setBegin(interval.end());
+    d->ensureParsed();
+    if (d->m_error != NoError) {
+        return {};
+    }
+    return evaluateNextInterval(d.data(), interval);
+}
+
+std::vector<Interval> OpeningHours::intervals(const QDateTime &begin, const QDateTime &end) const
+{
+    std::vector<Interval> result;
+    d->ensureParsed();
+    if (d->m_error != NoError || end <= begin) {
+        return result;
+    }
+
+    // same as iterating with interval() and nextInterval(), without checking the parser state for every step
+    for (auto i = evaluateInterval(d.data(), begin); i.isValid(); i = evaluateNextInterval(d.data(), i)) {
+        result.push_back(i);
+        // evaluation errors abort iteration, the same way as interval() returning nothing afterwards does
+        if (i.hasOpenEnd() || i.end() >= end || d->m_error != NoError) {
+            break;
         }
-        return i;
     }
-    return {};
+    return result;
 }
 #endif
 
+/** Day of week (1-7) for a schema.org DayOfWeek value, or 0 if unknown.
+ *  The value can be the plain day name, or prefixed by the schema.org URL or namespace.
+ */
+static int jsonLdWeekday(const QString &value)
+{
+    static constexpr const char *s_dayNames[] = { "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday" };
+
+    const auto nameBegin = std::max(value.lastIndexOf(QLatin1Char('/')), value.lastIndexOf(QLatin1Char(':'))) + 1;
+    const auto nameSize = value.size() - nameBegin;
+    if (nameSize < 6) {
+        return 0;
+    }
+
+    // first letter and length are unique for all day names
+    int day = 0;
+    switch (value.at(nameBegin).unicode()) {
+    case 'M':
+        day = 1;
+        break;
+    case 'T':
+        day = nameSize == 7 ? 2 : 4;
+        break;
+    case 'W':
+        day = 3;
+        break;
+    case 'F':
+        day = 5;
+        break;
+    case 'S':
+        day = nameSize == 8 ? 6 : 7;
+        break;
+    default:
+        return 0;
+    }
+    const auto name = QLatin1String(s_dayNames[day - 1]);
+    return nameSize == name.size() && value.endsWith(name) ? day : 0;
+}
+
 static Rule* openingHoursSpecToRule(const QJsonObject &obj)
 {
     if (obj.value(QLatin1String("@type")).toString() != QLatin1String("OpeningHoursSpecification")) {
@@ -632,29 +1373,22 @@ static Rule* openingHoursSpecToRule(const QJsonObject &obj)
     r->setState(State::Open);
     // ### is name or description used for comments?
 
-    r->m_timeSelector.reset(new Timespan);
-    r->m_timeSelector->begin = { Time::NoEvent, opens.hour(), opens.minute() };
-    r->m_timeSelector->end = { Time::NoEvent, closes.hour(), closes.minute() };
+    r->m_timeSelectors.resize(1);
+    r->m_timeSelectors[0].begin = { Time::NoEvent, opens.hour(), opens.minute() };
+    r->m_timeSelectors[0].end = { Time::NoEvent, closes.hour(), closes.minute() };
 
     const auto validFrom = QDate::fromString(obj.value(QLatin1String("validFrom")).toString(), Qt::ISODate);
     const auto validTo = QDate::fromString(obj.value(QLatin1String("validThrough")).toString(), Qt::ISODate);
     if (validFrom.isValid() || validTo.isValid()) {
-        r->m_monthdaySelector.reset(new MonthdayRange);
-        r->m_monthdaySelector->begin = { validFrom.year(), validFrom.month(), validFrom.day(), Date::FixedDate, { 0, 0, 0 } };
-        r->m_monthdaySelector->end = { validTo.year(), validTo.month(), validTo.day(), Date::FixedDate, { 0, 0, 0 } };
+        r->m_monthdaySelectors.resize(1);
+        r->m_monthdaySelectors[0].begin = { validFrom.year(), validFrom.month(), validFrom.day(), Date::FixedDate, { 0, 0, 0 } };
+        r->m_monthdaySelectors[0].end = { validTo.year(), validTo.month(), validTo.day(), Date::FixedDate, { 0, 0, 0 } };
     }
 
     const auto weekday = obj.value(QLatin1String("dayOfWeek")).toString();
     if (!weekday.isEmpty()) {
         r->m_weekdaySelector.reset(new WeekdayRange);
-        int i = 1;
-        for (const auto &d : { "Monday", "Tuesday", "Wednesday", "Thursday", "Friday", "Saturday", "Sunday"}) {
-            if (weekday.endsWith(QLatin1String(d))) {
-                r->m_weekdaySelector->beginDay = r->m_weekdaySelector->endDay = i;
-                break;
-            }
-            ++i;
-        }
+        r->m_weekdaySelector->beginDay = r->m_weekdaySelector->endDay = jsonLdWeekday(weekday);
     }
 
     return r;
@@ -664,43 +1398,81 @@ OpeningHours OpeningHours::fromJsonLd(const QJsonObject &obj)
 {
     OpeningHours result;
 
+    // multiple openingHours values are independent rules, so we can parse them one by one
+    // into the same rule list, which is equivalent to parsing them joined by "; "
     const auto oh = obj.value(QLatin1String("openingHours"));
     if (oh.isString()) {
         result = OpeningHours(oh.toString().toUtf8());
     } else if (oh.isArray()) {
         const auto ohA = oh.toArray();
-        QByteArray expr;
         for (const auto &exprV : ohA) {
-            const auto exprS = exprV.toString();
-            if (exprS.isEmpty()) {
+            const auto expr = exprV.toString().toUtf8();
+            const auto size = trimmedSize(expr.constData(), expr.size());
+            if (size == 0) {
                 continue;
             }
-            expr += (expr.isEmpty() ? "" : "; ") + exprS.toUtf8();
+            if (!result.d->appendRules(expr.constData(), size) || result.d->m_error == SyntaxError) {
+                result.d->m_error = SyntaxError;
+                break;
+            }
+        }
+        if (result.d->m_error == NoError) {
+            result.d->autocorrect();
         }
-        result = OpeningHours(expr);
     }
 
-    std::vector<std::unique_ptr<Rule>> rules;
     const auto ohs = obj.value(QLatin1String("openingHoursSpecification")).toArray();
+    const auto sohs = obj.value(QLatin1String("specialOpeningHoursSpecification")).toArray();
+    result.d->m_rules.reserve(result.d->m_rules.size() + ohs.size() + sohs.size());
     for (const auto &ohsV : ohs) {
         const auto r = openingHoursSpecToRule(ohsV.toObject());
         if (r) {
-            rules.push_back(std::unique_ptr<Rule>(r));
+            result.d->m_rules.push_back(std::shared_ptr<Rule>(r));
         }
     }
-    const auto sohs = obj.value(QLatin1String("specialOpeningHoursSpecification")).toArray();
     for (const auto &ohsV : sohs) {
         const auto r = openingHoursSpecToRule(ohsV.toObject());
         if (r) {
-            rules.push_back(std::unique_ptr<Rule>(r));
+            result.d->m_rules.push_back(std::shared_ptr<Rule>(r));
         }
     }
-    for (auto &r : rules) {
-        result.d->m_rules.push_back(std::move(r));
-    }
 
+    result.d->compactRules();
     result.d->validate();
     return result;
 }
 
+std::vector<OpeningHours> OpeningHours::fromJsonLdLines(QIODevice *device)
+{
+    // lines are read and converted in blocks of this size, to bound the amount of raw
+    // input kept in memory while still giving the worker threads enough to do
+    constexpr std::size_t BlockSize = 4096;
+
+    std::vector<OpeningHours> result;
+    std::vector<QByteArray> lines;
+    lines.reserve(BlockSize);
+    while (!device->atEnd()) {
+        lines.clear();
+        while (lines.size() < BlockSize && !device->atEnd()) {
+            lines.push_back(device->readLine());
+        }
+
+        const auto offset = result.size();
+        result.resize(offset + lines.size());
+        parallelFor(lines.size(), [&](std::size_t i) {
+            // most records of a web crawl have no opening hours at all, skip those without decoding them
+            // (that is openingHours, openingHoursSpecification or specialOpeningHoursSpecification)
+            if (!lines[i].contains("openingHours") && !lines[i].contains("OpeningHours")) {
+                return;
+            }
+            // only the opening hours members are decoded, which usually are a small part of the record
+            const auto obj = JsonLdScanner(lines[i].constData(), lines[i].size()).openingHoursMembers();
+            if (!obj.isEmpty()) {
+                result[offset + i] = fromJsonLd(obj);
+            }
+        });
+    }
+    return result;
+}
+
 #include "moc_openinghours.cpp"
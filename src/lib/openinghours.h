@@ -12,8 +12,11 @@
 #include <QExplicitlySharedDataPointer>
 #include <QMetaType>
 
+#include <vector>
+
 class QByteArray;
 class QDateTime;
+class QIODevice;
 class QJsonObject;
 class QString;
 class QTimeZone;
@@ -21,6 +24,7 @@ class QTimeZone;
 /** OSM opening hours parsing and evaluation. */
 namespace KOpeningHours {
 
+class ExpressionCache;
 class Interval;
 class OpeningHoursPrivate;
 
@@ -62,6 +66,16 @@ public:
      *  If @p openingHours doesn't match @p modes, error() return IncompatibleMode.
      */
     explicit OpeningHours(const char *openingHours, std::size_t size, Modes modes = IntervalMode);
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+    /** Parse OSM opening hours expression @p openingHours.
+     *  This is the same as passing the UTF-8 representation of @p openingHours,
+     *  without the need for a temporary QByteArray.
+     *  @param modes Specify whether time interval and/or point in time expressions are expected.
+     *  If @p openingHours doesn't match @p modes, error() return IncompatibleMode.
+     *  @since 26.08.0
+     */
+    explicit OpeningHours(QStringView openingHours, Modes modes = IntervalMode);
+#endif
 
     OpeningHours(const OpeningHours&);
     OpeningHours(OpeningHours&&);
@@ -84,6 +98,57 @@ public:
      *  at once.
      */
     void setExpression(const char *openingHours, std::size_t size, Modes modes = IntervalMode);
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+    /** Parse OSM opening hours expression @p openingHours.
+     *  @see OpeningHours(QStringView, Modes)
+     *  @since 26.08.0
+     */
+    void setExpression(QStringView openingHours, Modes modes = IntervalMode);
+#endif
+
+    /** Parse the OSM opening hours expressions in @p expressions in parallel.
+     *  This is equivalent to creating one instance per expression, but distributes
+     *  the work over all available cores.
+     *  @param modes Specify whether time interval and/or point in time expressions are expected.
+     *  @returns one instance per entry in @p expressions, in the same order. Use error() on
+     *  those to check for invalid expressions.
+     *  @since 26.08.0
+     */
+    static std::vector<OpeningHours> parseBatch(const std::vector<QByteArray> &expressions, Modes modes = IntervalMode);
+
+    /** Create an instance for OSM opening hours expression @p openingHours, without parsing it yet.
+     *  Parsing happens on first use of anything depending on its result, such as error(),
+     *  normalizedExpression() or interval(). That first use is thread-safe, also on copies
+     *  of the returned instance.
+     *  This is useful when creating many instances of which only a few are actually used.
+     *  @param modes Specify whether time interval and/or point in time expressions are expected.
+     *  @since 26.08.0
+     */
+    static OpeningHours deferred(const QByteArray &openingHours, Modes modes = IntervalMode);
+
+    /** Compact binary representation of the parsed expression.
+     *  This allows to persist parsed expressions and to restore them with deserialize(),
+     *  which is considerably cheaper than parsing the expression again.
+     *  The binary representation contains the modes but not the location, region or timezone.
+     *  It is versioned, and only readable by library versions using the same format version.
+     *  @returns an empty byte array for instances that are Null or contain a syntax error.
+     *  @since 26.08.0
+     */
+    QByteArray serialize() const;
+    /** Restore an instance from the binary representation created by serialize().
+     *  This restores the rules into the same in-memory form parsing produces, the result does
+     *  not reference @p data, which can therefore be released (or unmapped) right afterwards.
+     *  @returns an instance with error() returning SyntaxError if @p data is not a valid
+     *  binary representation in the format used by this library version, and a Null instance
+     *  if @p data is empty.
+     *  @since 26.08.0
+     */
+    static OpeningHours deserialize(const char *data, std::size_t size);
+    /** Restore an instance from the binary representation created by serialize().
+     *  @see deserialize(const char*, std::size_t)
+     *  @since 26.08.0
+     */
+    static OpeningHours deserialize(const QByteArray &data);
 
     /** Returns the OSM opening hours expression reconstructed from this object.
      * In many cases it will be the same as the expression given to the constructor
@@ -98,6 +163,13 @@ public:
      */
     QByteArray simplifiedExpression() const;
 
+    /** Simplify this expression in place.
+     *  Afterwards normalizedExpression() returns what simplifiedExpression() returned before.
+     *  This does not change the result of evaluating the expression.
+     *  @since 26.08.0
+     */
+    void simplify();
+
     /** Geographic coordinate at which this expression should be evaluated.
      *  This is needed for expressions containing location-based variable time references,
      *  such as "sunset". If the expression requires a location, error() returns @c MissingLocation
@@ -142,11 +214,43 @@ public:
     /** Error status of this expression. */
     Error error() const;
 
+    /** Check the OSM opening hours expression @p openingHours for validity.
+     *  This returns the same as error() would for an instance created from @p openingHours,
+     *  without location or region set.
+     *  Only expressions in canonical form (as returned by normalizedExpression()) consisting of
+     *  weekday ranges, PH, time spans and a state, separated by "; " or ", ", are checked without
+     *  building up the internal representation needed for evaluation. Anything else is fully
+     *  parsed, and thus costs the same as creating an instance.
+     *  @param modes Specify whether time interval and/or point in time expressions are expected.
+     *  @since 26.08.0
+     */
+    static Error check(const QByteArray &openingHours, Modes modes = IntervalMode);
+    /** Check the OSM opening hours expression @p openingHours for validity.
+     *  @see check(const QByteArray&, Modes)
+     *  @since 26.08.0
+     */
+    static Error check(const char *openingHours, std::size_t size, Modes modes = IntervalMode);
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+    /** Check the OSM opening hours expression @p openingHours for validity.
+     *  @see check(const QByteArray&, Modes)
+     *  @since 26.08.0
+     */
+    static Error check(QStringView openingHours, Modes modes = IntervalMode);
+#endif
+
 #ifndef KOPENINGHOURS_VALIDATOR_ONLY
     /** Returns the interval containing @p dt. */
     Q_INVOKABLE KOpeningHours::Interval interval(const QDateTime &dt) const;
     /** Returns the interval immediately following @p interval. */
     Q_INVOKABLE KOpeningHours::Interval nextInterval(const KOpeningHours::Interval &interval) const;
+    /** Returns the intervals covering the time from @p begin to @p end.
+     *  This is the same as calling interval() for @p begin, followed by nextInterval() until
+     *  reaching an interval ending at or after @p end or without an end, and is provided
+     *  for convenience. Each interval is evaluated the same way as by nextInterval().
+     *  @returns an empty list if @p end isn't after @p begin.
+     *  @since 26.08.0
+     */
+    std::vector<KOpeningHours::Interval> intervals(const QDateTime &begin, const QDateTime &end) const;
 #endif
 
     /** Convert opening hours in schema.org JSON-LD format.
@@ -157,7 +261,19 @@ public:
      */
     static OpeningHours fromJsonLd(const QJsonObject &obj);
 
+    /** Convert opening hours of schema.org objects in JSON Lines format read from @p device.
+     *  Each line is expected to contain one JSON-LD object, which is converted as described
+     *  in fromJsonLd(). The input is read in blocks, with the lines of each block being decoded
+     *  and converted in parallel on all available cores.
+     *  @returns one instance per line in @p device, in the same order. Instances for lines
+     *  without opening hours information or which aren't valid JSON are Null.
+     *  @since 26.08.0
+     */
+    static std::vector<OpeningHours> fromJsonLdLines(QIODevice *device);
+
 private:
+    friend class ExpressionCache;
+
     // for QML bindings
     Q_DECL_HIDDEN QString normalizedExpressionString() const;
     Q_DECL_HIDDEN QString timeZoneId() const;
@@ -8,15 +8,20 @@
 #define KOPENINGHOURS_OPENINGHOURS_P_H
 
 #include "openinghours.h"
+#include "arena_p.h"
 #include "rule_p.h"
 
 #ifndef KOPENINGHOURS_VALIDATOR_ONLY
+#include "weeklyevaluator_p.h"
+
 #include <KHolidays/HolidayRegion>
 #endif
 
+#include <QMutex>
 #include <QSharedData>
 #include <QTimeZone>
 
+#include <atomic>
 #include <cmath>
 #include <memory>
 #include <vector>
@@ -27,12 +32,47 @@ public:
     void finalizeRecovery();
     void autocorrect();
     void simplify();
+    /** Replace rules shared with other instances by copies, so they can be modified. */
+    void detachRules();
     void validate();
+    /** Same as validate(), unless parsing is deferred in which case this happens as part of parsing. */
+    void revalidate();
+    /** Prepare the parsed rules for evaluation.
+     *  Needs to be called again whenever the rules are modified.
+     */
+    void compactRules();
     void addRule(Rule *parsedRule);
     void restartFrom(int pos, Rule::Type nextRuleType);
     bool isRecovering() const;
 
-    std::vector<std::unique_ptr<Rule>> m_rules;
+    /** Parse @p size bytes at @p data with the current mode, replacing any previous content. */
+    void parse(const char *data, std::size_t size);
+    /** Parse @p size bytes at @p data and append the resulting rules, without any post-processing.
+     *  The new rules are allocated from m_arena, which is created if necessary. This must
+     *  therefore not be called anymore once the rules have been shared with other instances.
+     *  @p data must not be empty.
+     *  @returns @c false in case of a syntax error.
+     */
+    bool appendRules(const char *data, std::size_t size);
+    /** Parse the expression passed to OpeningHours::deferred(), if that didn't happen yet.
+     *  This is safe to call from multiple threads at the same time.
+     */
+    void ensureParsed();
+
+    /** Memory of the nodes in m_rules.
+     *  This is shared along with the rules, and has to be declared before those so it
+     *  is destroyed after them.
+     */
+    std::shared_ptr<Arena> m_arena;
+    /** Parsed rules.
+     *  Those can be shared between multiple instances (see ExpressionCache), so they must
+     *  not be modified anymore once parsing is complete.
+     */
+    std::vector<std::shared_ptr<Rule>> m_rules;
+#ifndef KOPENINGHOURS_VALIDATOR_ONLY
+    /** Fast path for evaluating weekly recurring rules, if applicable to m_rules. */
+    std::shared_ptr<const WeeklyEvaluator> m_weeklyEvaluator;
+#endif
     OpeningHours::Modes m_modes = OpeningHours::IntervalMode;
     OpeningHours::Error m_error = OpeningHours::NoError;
 
@@ -46,6 +86,11 @@ public:
     KHolidays::HolidayRegion m_region;
 #endif
     QTimeZone m_timezone = QTimeZone::systemTimeZone();
+
+    /** Expression to parse on first use, see OpeningHours::deferred(). */
+    QByteArray m_deferredExpression;
+    std::atomic<bool> m_deferred{false};
+    QMutex m_deferredMutex;
 };
 
 }
@@ -0,0 +1,19 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "openinghoursliteral.h"
+#include "expressioncache.h"
+
+#include <QByteArray>
+
+using namespace KOpeningHours;
+
+OpeningHours Literal::parse(const char *expression, std::size_t size)
+{
+    // literals have static storage duration, so the cache can refer to them rather than copying them
+    static ExpressionCache s_cache;
+    return s_cache.openingHours(QByteArray::fromRawData(expression, size));
+}
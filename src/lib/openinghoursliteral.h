@@ -0,0 +1,202 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_OPENINGHOURSLITERAL_H
+#define KOPENINGHOURS_OPENINGHOURSLITERAL_H
+
+#include "kopeninghours_export.h"
+#include "openinghours.h"
+
+#include <cstddef>
+
+namespace KOpeningHours {
+
+/** Opening hours expression literals, see KOPENINGHOURS_LITERAL(). */
+namespace Literal {
+
+/** @internal Compile-time syntax check for the expression subset supported by literals.
+ *  This covers the same subset as the canonical parser fast path, that is rules consisting of
+ *  weekday ranges, PH, time spans and a state, separated by "; " or ", ".
+ */
+class Validator
+{
+public:
+    constexpr explicit Validator(const char *data, std::size_t size)
+        : m_it(data)
+        , m_end(data + size)
+    {
+    }
+
+    constexpr bool validate()
+    {
+        if (m_it == m_end) {
+            return false;
+        }
+        for (;;) {
+            if (!rule()) {
+                return false;
+            }
+            if (m_it == m_end) {
+                return true;
+            }
+            if (!consume(", ") && !consume("; ") && !consume(";")) {
+                return false;
+            }
+            if (m_it == m_end) {
+                return false;
+            }
+        }
+    }
+
+private:
+    static constexpr bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    constexpr bool rule()
+    {
+        bool needsStateSeparator = false;
+        if (consume("24/7")) {
+            needsStateSeparator = true;
+        } else {
+            if (m_it != m_end && (*m_it == 'M' || *m_it == 'T' || *m_it == 'W' || *m_it == 'F' || *m_it == 'S' || *m_it == 'P')) {
+                do {
+                    if (!weekdayRange()) {
+                        return false;
+                    }
+                } while (consumeListSeparator());
+                if (atRuleEnd()) {
+                    return true;
+                }
+                if (!consume(" ")) {
+                    return false;
+                }
+            }
+            if (m_it != m_end && isDigit(*m_it)) {
+                do {
+                    if (!time() || !consume("-") || !time()) {
+                        return false;
+                    }
+                } while (consumeListSeparator());
+                needsStateSeparator = true;
+            }
+        }
+
+        if (needsStateSeparator) {
+            if (atRuleEnd()) {
+                return true;
+            }
+            if (!consume(" ")) {
+                return false;
+            }
+        }
+        return (consume("off") || consume("closed") || consume("open") || consume("unknown")) && atRuleEnd();
+    }
+
+    constexpr bool weekdayRange()
+    {
+        if (consume("PH")) {
+            return true;
+        }
+        return weekday() && (!consume("-") || weekday());
+    }
+
+    constexpr bool weekday()
+    {
+        return consume("Mo") || consume("Tu") || consume("We") || consume("Th") || consume("Fr") || consume("Sa") || consume("Su");
+    }
+
+    constexpr bool time()
+    {
+        if (m_end - m_it < 5 || !isDigit(m_it[0]) || !isDigit(m_it[1]) || m_it[2] != ':' || !isDigit(m_it[3]) || !isDigit(m_it[4])) {
+            return false;
+        }
+        const int hour = (m_it[0] - '0') * 10 + m_it[1] - '0';
+        const int minute = (m_it[3] - '0') * 10 + m_it[4] - '0';
+        m_it += 5;
+        return hour <= 48 && minute < 60 && (m_it == m_end || !isDigit(*m_it));
+    }
+
+    constexpr bool consume(const char *token)
+    {
+        auto it = m_it;
+        for (; *token; ++token, ++it) {
+            if (it == m_end || *it != *token) {
+                return false;
+            }
+        }
+        m_it = it;
+        return true;
+    }
+
+    constexpr bool consumeListSeparator()
+    {
+        // ", " is a rule separator rather than a list separator
+        if (m_end - m_it > 1 && m_it[0] == ',' && m_it[1] != ' ') {
+            ++m_it;
+            return true;
+        }
+        return false;
+    }
+
+    constexpr bool atRuleEnd() const
+    {
+        return m_it == m_end || *m_it == ';' || (m_end - m_it > 1 && m_it[0] == ',' && m_it[1] == ' ');
+    }
+
+    const char *m_it;
+    const char *m_end;
+};
+
+/** Checks whether @p expression can be used with KOPENINGHOURS_LITERAL(). */
+constexpr bool isValid(const char *expression, std::size_t size)
+{
+    return Validator(expression, size).validate();
+}
+
+template <std::size_t N>
+constexpr bool isValid(const char (&expression)[N])
+{
+    return isValid(expression, N - 1);
+}
+
+/** @internal Returns the parsed instance for a literal expression, see KOPENINGHOURS_LITERAL(). */
+KOPENINGHOURS_EXPORT OpeningHours parse(const char *expression, std::size_t size);
+
+}
+}
+
+/** Opening hours expression literal, checked for syntax errors at compile time.
+ *  This evaluates to an OpeningHours instance in IntervalMode. The expression is parsed only once,
+ *  all instances created from the same expression share the parsed rules, but not their settings
+ *  such as location or region.
+ *
+ *  Only the subset of the opening hours syntax most expressions use is supported, in normalized form:
+ *  - one or more rules, separated by "; " (or ";") for normal rules and ", " for additional rules
+ *  - each rule is either "24/7", or a weekday selector and/or a time selector separated by a space,
+ *    optionally followed by a space and a state, or only a state
+ *  - weekday selectors are a comma-separated list (without spaces) of "PH", a single weekday
+ *    ("Mo" to "Su") or a weekday range ("Mo-Fr")
+ *  - time selectors are a comma-separated list (without spaces) of time spans "HH:MM-HH:MM",
+ *    with two-digit hours from 00 to 48 and minutes from 00 to 59
+ *  - states are "open", "closed", "off" or "unknown"
+ *
+ *  Anything else, such as comments, SH, month, date, week or year selectors, nth weekdays,
+ *  offsets, open ends or sun events, fails to compile, even if it is a valid expression.
+ *  Use OpeningHours directly for those.
+ *  @code
+ *  const auto oh = KOPENINGHOURS_LITERAL("Mo-Fr 08:00-18:00; Sa 10:00-14:00; PH off");
+ *  @endcode
+ *  @since 26.08.0
+ */
+#define KOPENINGHOURS_LITERAL(expression) \
+    ([]() { \
+        static_assert(KOpeningHours::Literal::isValid(expression), "Invalid or unsupported opening hours literal: " expression); \
+        return KOpeningHours::Literal::parse(expression, sizeof(expression) - 1); \
+    }())
+
+#endif // KOPENINGHOURS_OPENINGHOURSLITERAL_H
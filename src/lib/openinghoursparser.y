@@ -29,31 +29,55 @@ static void initSelectors(Selectors &sels)
     sels.wideRangeSelectorComment.len = 0;
     sels.seen_24_7 = false;
     sels.colonAfterWideRangeSelector = false;
+    sels.last.timeSelector = nullptr;
+}
+
+/** Moves the selectors in the list starting at @p first into @p selectors, and deletes the list. */
+template <typename T>
+static void moveSelectors(ParsedSelector<T> *first, std::vector<T> &selectors)
+{
+    std::size_t count = 0;
+    for (auto s = first; s; s = s->next.get()) {
+        ++count;
+    }
+    selectors.reserve(count);
+    for (auto s = first; s; s = s->next.get()) {
+        selectors.push_back(std::move(static_cast<T&>(*s)));
+    }
+    delete first;
 }
 
 static void applySelectors(const Selectors &sels, Rule *rule)
 {
-    rule->m_timeSelector.reset(sels.timeSelector);
+    moveSelectors(sels.timeSelector, rule->m_timeSelectors);
     rule->m_weekdaySelector.reset(sels.weekdaySelector);
-    rule->m_weekSelector.reset(sels.weekSelector);
-    rule->m_monthdaySelector.reset(sels.monthdaySelector);
-    rule->m_yearSelector.reset(sels.yearSelector);
+    moveSelectors(sels.weekSelector, rule->m_weekSelectors);
+    moveSelectors(sels.monthdaySelector, rule->m_monthdaySelectors);
+    moveSelectors(sels.yearSelector, rule->m_yearSelectors);
     rule->m_seen_24_7 = sels.seen_24_7;
     rule->m_colonAfterWideRangeSelector = sels.colonAfterWideRangeSelector;
-    rule->m_wideRangeSelectorComment = QString::fromUtf8(sels.wideRangeSelectorComment.str, sels.wideRangeSelectorComment.len);
+    rule->m_wideRangeSelectorComment = QByteArray(sels.wideRangeSelectorComment.str, sels.wideRangeSelectorComment.len);
 }
 
-static bool extendMonthdaySelector(MonthdayRange *monthdaySelector, int beginDay, int endDay)
+/** Append @p selector to the list ending with @p last, and update @p last to the new end of the list. */
+template <typename T>
+static void appendToLast(T *&last, T *selector)
 {
-    const auto prevSelector = lastSelector(monthdaySelector);
+    last->next.reset(selector);
+    last = lastSelector(selector);
+}
+
+static bool extendMonthdaySelector(Selectors &sels, int beginDay, int endDay)
+{
+    const auto prevSelector = sels.last.monthdaySelector;
     if (prevSelector->begin.year == prevSelector->end.year
      && prevSelector->begin.month == prevSelector->end.month)
     {
-        auto sel = new MonthdayRange;
+        auto sel = new ParsedMonthdayRange;
         sel->begin = sel->end = prevSelector->end;
         sel->begin.day = beginDay;
         sel->end.day = endDay;
-        appendSelector(prevSelector, sel);
+        appendToLast(sels.last.monthdaySelector, sel);
         return true;
     }
     return false;
@@ -68,20 +92,41 @@ static bool extendMonthdaySelector(MonthdayRange *monthdaySelector, int beginDay
 
 using namespace KOpeningHours;
 
+/** Selector being parsed, linked to the following selectors of the same kind.
+ *  Those lists are moved into the contiguous selector storage of Rule once the rule is complete.
+ */
+template <typename T>
+class ParsedSelector : public T, public ArenaAllocated
+{
+public:
+    std::unique_ptr<ParsedSelector> next;
+};
+using ParsedTimespan = ParsedSelector<Timespan>;
+using ParsedWeek = ParsedSelector<Week>;
+using ParsedMonthdayRange = ParsedSelector<MonthdayRange>;
+using ParsedYearRange = ParsedSelector<YearRange>;
+
 struct StringRef {
     const char *str;
     int len;
 };
 
 struct Selectors {
-    Timespan *timeSelector;
+    ParsedTimespan *timeSelector;
     WeekdayRange *weekdaySelector;
-    Week *weekSelector;
-    MonthdayRange *monthdaySelector;
-    YearRange *yearSelector;
+    ParsedWeek *weekSelector;
+    ParsedMonthdayRange *monthdaySelector;
+    ParsedYearRange *yearSelector;
     StringRef wideRangeSelectorComment;
     bool seen_24_7;
     bool colonAfterWideRangeSelector;
+    // end of the selector list currently being built, so appending doesn't need to walk the entire list
+    union {
+        ParsedTimespan *timeSelector;
+        ParsedWeek *weekSelector;
+        ParsedMonthdayRange *monthdaySelector;
+        ParsedYearRange *yearSelector;
+    } last;
 };
 
 #ifndef YY_TYPEDEF_YY_SCANNER_T
@@ -99,6 +144,18 @@ typedef void* yyscan_t;
 %parse-param { KOpeningHours::OpeningHoursPrivate *parser }
 %parse-param { yyscan_t scanner }
 
+// The grammar is not LALR(1), the GLR parser resolves the following shift/reduce conflicts by splitting the parse stack:
+// - 8 on T_SLASH, between the "Ruleset T_SLASH error" recovery rule and the valid uses of a slash
+// - 3 on T_WEEKDAY/T_INTEGER after a month, between a full month selector and the start of a date
+//   ("Dec Mo" vs. "Dec Su[-1]", "Dec 10:00-12:00" vs. "Dec 24")
+// - 1 on T_INTEGER after T_MINUS, between a range separator and a negative day offset
+// - 2 on T_MINUS after a weekday-based month offset, between a range separator and a day offset
+// - 2 on T_COMMA after a holiday-on-weekday selector, between it being complete and the list continuing
+// - 2 on T_ADDITIONAL_RULE_SEPARATOR after a monthday selector, between a rule separator and a day list
+//   ("Dec 24, Mo off" vs. "Dec 24, 26 off")
+// Resolving those with a single token of lookahead would change which input is accepted, and the
+// split stacks usually merge again after one or two tokens. Already normalized expressions do
+// not reach this parser in the first place, see CanonicalParser.
 %glr-parser
 %expect 18
 // (1) is for "T_YEAR T_COMMA T_YEAR T_MONTH", which is syntactically invalid anyway
@@ -112,15 +169,15 @@ typedef void* yyscan_t;
     Rule *rule;
     Time time;
     Selectors selectors;
-    Timespan *timespan;
+    ParsedTimespan *timespan;
     NthEntry nthEntry;
     NthSequence *nthSequence;
     WeekdayRange *weekdayRange;
-    Week *week;
+    ParsedWeek *week;
     Date date;
-    MonthdayRange *monthdayRange;
+    ParsedMonthdayRange *monthdayRange;
     DateOffset dateOffset;
-    YearRange *yearRange;
+    ParsedYearRange *yearRange;
 }
 
 %token T_NORMAL_RULE_SEPARATOR
@@ -364,10 +421,11 @@ TimeSelector:
   Timespan[T] {
     initSelectors($$);
     $$.timeSelector = $T;
+    $$.last.timeSelector = lastSelector($T);
   }
 | TimeSelector[T1] T_COMMA Timespan[T2] {
     $$ = $T1;
-    appendSelector($$.timeSelector, $T2);
+    appendToLast($$.last.timeSelector, $T2);
   }
 | TimeSelector[T] T_COMMA error {
     $$ = $T;
@@ -383,35 +441,35 @@ TimeSelector:
 
 Timespan:
   Time[T] {
-    $$ = new Timespan;
+    $$ = new ParsedTimespan;
     $$->begin = $$->end = $T;
     $$->pointInTime = true;
   }
 | Time[T] T_PLUS {
-    $$ = new Timespan;
+    $$ = new ParsedTimespan;
     $$->begin = $$->end = $T;
     $$->pointInTime = true;
     $$->openEnd = true;
   }
 | Time[T1] RangeSeparator Time[T2] {
-    $$ = new Timespan;
+    $$ = new ParsedTimespan;
     $$->begin = $T1;
     $$->end = $T2;
   }
 | Time[T1] RangeSeparator Time[T2] T_PLUS {
-    $$ = new Timespan;
+    $$ = new ParsedTimespan;
     $$->begin = $T1;
     $$->end = $T2;
     $$->openEnd = true;
   }
 | Time[T1] RangeSeparator Time[T2] T_SLASH T_INTEGER[I] {
-    $$ = new Timespan;
+    $$ = new ParsedTimespan;
     $$->begin = $T1;
     $$->end = $T2;
     $$->interval = $I;
   }
 | Time[T1] RangeSeparator Time[T2] T_SLASH ExtendedHourMinute[I] {
-    $$ = new Timespan;
+    $$ = new ParsedTimespan;
     $$->begin = $T1;
     $$->end = $T2;
     $$->interval = $I.hour * 60 + $I.minute;
@@ -571,25 +629,26 @@ WeekSelector:
   T_KEYWORD_WEEK Week[W] {
     initSelectors($$);
     $$.weekSelector = $W;
+    $$.last.weekSelector = lastSelector($W);
   }
 | WeekSelector[W1] T_COMMA Week[W2] {
     $$ = $W1;
-    appendSelector($$.weekSelector, $W2);
+    appendToLast($$.last.weekSelector, $W2);
   }
 ;
 
 Week:
   T_INTEGER[N] {
-    $$ = new Week;
+    $$ = new ParsedWeek;
     $$->beginWeek = $$->endWeek = $N;
   }
 | T_INTEGER[N1] T_MINUS T_INTEGER[N2] {
-    $$ = new Week;
+    $$ = new ParsedWeek;
     $$->beginWeek = $N1;
     $$->endWeek = $N2;
   }
 | T_INTEGER[N1] T_MINUS T_INTEGER[N2] T_SLASH T_INTEGER[I] {
-    $$ = new Week;
+    $$ = new ParsedWeek;
     $$->beginWeek = $N1;
     $$->endWeek = $N2;
     $$->interval = $I;
@@ -603,16 +662,17 @@ MonthdaySelector:
   MonthdayRange[M] {
     initSelectors($$);
     $$.monthdaySelector = $M;
+    $$.last.monthdaySelector = lastSelector($M);
   }
 | MonthdaySelector[S] T_COMMA MonthdayRangeAdditional[M] {
     $$ = $S;
-    appendSelector($$.monthdaySelector, $M);
+    appendToLast($$.last.monthdaySelector, $M);
   }
 | MonthdaySelector[S] T_COMMA T_INTEGER[D] {
     // month day sets, not covered the official grammar but in the
     // description in https://wiki.openstreetmap.org/wiki/Key:opening_hours#Summary_syntax
     $$ = $S;
-    if (!extendMonthdaySelector($$.monthdaySelector, $D, $D)) {
+    if (!extendMonthdaySelector($$, $D, $D)) {
         delete $$.monthdaySelector;
         YYABORT;
     }
@@ -620,7 +680,7 @@ MonthdaySelector:
 | MonthdaySelector[S] T_ADDITIONAL_RULE_SEPARATOR T_INTEGER[D] {
     // same as the above, just with the wrong ", " separator
     $$ = $S;
-    if (!extendMonthdaySelector($$.monthdaySelector, $D, $D)) {
+    if (!extendMonthdaySelector($$, $D, $D)) {
         delete $$.monthdaySelector;
         YYABORT;
     }
@@ -628,7 +688,7 @@ MonthdaySelector:
 | MonthdaySelector[S] T_COMMA T_INTEGER[D1] T_MINUS T_INTEGER[D2] {
     // same with a range of days
     $$ = $S;
-    if (!extendMonthdaySelector($$.monthdaySelector, $D1, $D2)) {
+    if (!extendMonthdaySelector($$, $D1, $D2)) {
         delete $$.monthdaySelector;
         YYABORT;
     }
@@ -636,7 +696,7 @@ MonthdaySelector:
 | MonthdaySelector[S] T_ADDITIONAL_RULE_SEPARATOR T_INTEGER[D1] T_MINUS T_INTEGER[D2] {
     // same as the above, just with the wrong ", " separator
     $$ = $S;
-    if (!extendMonthdaySelector($$.monthdaySelector, $D1, $D2)) {
+    if (!extendMonthdaySelector($$, $D1, $D2)) {
         delete $$.monthdaySelector;
         YYABORT;
     }
@@ -645,59 +705,59 @@ MonthdaySelector:
 
 MonthdayRange:
   T_YEAR[Y] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $$->end = { $Y, 0, 0, Date::FixedDate, { 0, 0, 0 } };
   }
 | MonthdayRangeAdditional[M] { $$ = $M; }
 
 MonthdayRangeAdditional:
   T_MONTH[M] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $$->end = { 0, $M, 0, Date::FixedDate, { 0, 0, 0 } };
   }
 | T_YEAR[Y] T_MONTH[M] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $$->end = { $Y, $M, 0, Date::FixedDate, { 0, 0, 0 } };
   }
 | T_MONTH[M1] RangeSeparator T_MONTH[M2] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = { 0, $M1, 0, Date::FixedDate, { 0, 0, 0 } };
     $$->end = { 0, $M2, 0, Date::FixedDate, { 0, 0, 0 } };
   }
 | T_YEAR[Y] T_MONTH[M1] RangeSeparator T_MONTH[M2] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = { $Y, $M1, 0, Date::FixedDate, { 0, 0, 0 } };
     $$->end = { $Y, $M2, 0, Date::FixedDate, { 0, 0, 0 } };
   }
 | T_YEAR[Y1] T_MONTH[M1] RangeSeparator T_YEAR[Y2] T_MONTH[M2] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = { $Y1, $M1, 0, Date::FixedDate, { 0, 0, 0 } };
     $$->end = { $Y2, $M2, 0, Date::FixedDate, { 0, 0, 0 } };
   }
 | T_MONTH[M1] AltMonthdayOffset[O1] RangeSeparator T_MONTH[M2] AltMonthdayOffset[O2] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = { 0, $M1, 0, Date::FixedDate, $O1 };
     $$->end = { 0, $M2, 0, Date::FixedDate, $O2 };
   }
 | DateFrom[D] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $$->end = $D;
   }
 | DateFrom[D] DateOffset[O] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $D;
     $$->begin.offset += $O;
     $$->end = $$->begin;
   }
 | DateFrom[F] RangeSeparator DateTo[T] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $F;
     $$->end = $T;
     if ($$->end.year == 0) { $$->end.year = $$->begin.year; }
     if ($$->end.month == 0) { $$->end.month = $$->begin.month; }
   }
 | DateFrom[F] DateOffset[OF] RangeSeparator DateTo[T] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $F;
     $$->begin.offset += $OF;
     $$->end = $T;
@@ -705,7 +765,7 @@ MonthdayRangeAdditional:
     if ($$->end.month == 0) { $$->end.month = $$->begin.month; }
   }
 | DateFrom[F] RangeSeparator DateTo[T] DateOffset[OT] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $F;
     $$->end = $T;
     if ($$->end.year == 0) { $$->end.year = $$->begin.year; }
@@ -713,17 +773,17 @@ MonthdayRangeAdditional:
     $$->end.offset += $OT;
   }
 | DateFrom[F] RangeSeparator T_MONTH[M] AltMonthdayOffset[O] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $F;
     $$->end = { $F.year, $M, 0, Date::FixedDate, $O };
   }
 | T_MONTH[M] AltMonthdayOffset[O] RangeSeparator DateTo[T] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = { 0, $M, 0, Date::FixedDate, $O };
     $$->end = $T;
   }
 | DateFrom[F] DateOffset[OF] RangeSeparator DateTo[T] DateOffset[OT] {
-    $$ = new MonthdayRange;
+    $$ = new ParsedMonthdayRange;
     $$->begin = $F;
     $$->begin.offset += $OF;
     $$->end = $T;
@@ -772,26 +832,28 @@ YearSelector:
   YearRangeStandalone[Y] {
     initSelectors($$);
     $$.yearSelector = $Y;
+    $$.last.yearSelector = lastSelector($Y);
   }
 | YearSelectorCombined[S] T_COMMA YearRange[Y] {
     $$ = $S;
-    appendSelector($$.yearSelector, $Y);
+    appendToLast($$.last.yearSelector, $Y);
   }
 ;
 YearSelectorCombined:
   YearRange[Y] {
     initSelectors($$);
     $$.yearSelector = $Y;
+    $$.last.yearSelector = lastSelector($Y);
   }
 | YearSelectorCombined[S] T_COMMA YearRange[Y] {
     $$ = $S;
-    appendSelector($$.yearSelector, $Y);
+    appendToLast($$.last.yearSelector, $Y);
   }
 ;
 
 YearRange:
   T_YEAR[Y] {
-    $$ = new YearRange;
+    $$ = new ParsedYearRange;
     $$->begin = $$->end = $Y;
   }
 | YearRangeStandalone[Y] { $$ = $Y; }
@@ -799,7 +861,7 @@ YearRange:
 
 YearRangeStandalone:
   T_YEAR[Y1] RangeSeparator T_YEAR[Y2] {
-    $$ = new YearRange;
+    $$ = new ParsedYearRange;
     $$->begin = $Y1;
     $$->end = $Y2;
     if ($$->end < $$->begin) {
@@ -808,12 +870,12 @@ YearRangeStandalone:
     }
   }
 | T_YEAR[Y] T_SLASH T_INTEGER[I] {
-    $$ = new YearRange;
+    $$ = new ParsedYearRange;
     $$->begin = $Y;
     $$->interval = $I;
   }
 | T_YEAR[Y1] RangeSeparator T_YEAR[Y2] T_SLASH T_INTEGER[I] {
-    $$ = new YearRange;
+    $$ = new ParsedYearRange;
     $$->begin = $Y1;
     $$->end = $Y2;
     if ($$->end < $$->begin) {
@@ -823,7 +885,7 @@ YearRangeStandalone:
     $$->interval = $I;
   }
 | T_YEAR[Y] T_PLUS {
-    $$ = new YearRange;
+    $$ = new ParsedYearRange;
     $$->begin = $Y;
   }
 
@@ -7,6 +7,7 @@
 #include "rule_p.h"
 #include "logging.h"
 #include "openinghours_p.h"
+#include "utf8_p.h"
 
 
 using namespace KOpeningHours;
@@ -53,11 +54,11 @@ void Rule::setComment(const char *str, int len)
 int Rule::requiredCapabilities() const
 {
     int c = Capability::None;
-    c |= m_timeSelector ? m_timeSelector->requiredCapabilities() : Capability::None;
+    c |= KOpeningHours::requiredCapabilities(m_timeSelectors);
     c |= m_weekdaySelector ? m_weekdaySelector->requiredCapabilities() : Capability::None;
-    c |= m_weekSelector ? m_weekSelector->requiredCapabilities() : Capability::None;
-    c |= m_monthdaySelector ? m_monthdaySelector->requiredCapabilities() : Capability::None;
-    c |= m_yearSelector ? m_yearSelector->requiredCapabilities() : Capability::None;
+    c |= KOpeningHours::requiredCapabilities(m_weekSelectors);
+    c |= KOpeningHours::requiredCapabilities(m_monthdaySelectors);
+    c |= KOpeningHours::requiredCapabilities(m_yearSelectors);
     c |= m_wideRangeSelectorComment.isEmpty() ? Capability::None : Capability::NotImplemented;
 
     return c;
@@ -74,79 +75,120 @@ bool Rule::isEmpty() const
 
 bool Rule::hasSmallRangeSelector() const
 {
-    return m_weekdaySelector || m_timeSelector;
+    return m_weekdaySelector || !m_timeSelectors.empty();
 }
 
 bool Rule::hasWideRangeSelector() const
 {
-    return m_yearSelector || m_weekSelector || m_monthdaySelector || !m_wideRangeSelectorComment.isEmpty();
+    return !m_yearSelectors.empty() || !m_weekSelectors.empty() || !m_monthdaySelectors.empty() || !m_wideRangeSelectorComment.isEmpty();
 }
 
-QByteArray Rule::toExpression() const
+template <typename T>
+static void selectorsToExpression(QByteArray &out, const std::vector<T> &selectors)
 {
-    QByteArray expr;
-    if (!m_timeSelector && !m_weekdaySelector && !m_monthdaySelector && !m_weekSelector && !m_yearSelector) {
-        if (m_seen_24_7) {
-            expr = "24/7";
+    for (const auto &selector : selectors) {
+        if (&selector != &selectors.front()) {
+            out += ',';
+        }
+        selector.toExpression(out);
+    }
+}
+
+static void selectorsToExpression(QByteArray &out, const std::vector<MonthdayRange> &selectors)
+{
+    MonthdayRange prev;
+    for (const auto &selector : selectors) {
+        if (&selector != &selectors.front()) {
+            out += ',';
         }
+        selector.toExpression(out, prev);
+        prev = selector;
     }
+}
+
+void Rule::toExpression(QByteArray &out) const
+{
+    const auto startSize = out.size();
     auto maybeSpace = [&]() {
-        if (!expr.isEmpty()) {
-            expr += ' ';
+        if (out.size() != startSize) {
+            out += ' ';
         }
     };
-    if (m_yearSelector) {
-        expr = m_yearSelector->toExpression();
+    if (selectorCount() == 0) {
+        if (m_seen_24_7) {
+            out += "24/7";
+        }
     }
-    if (m_monthdaySelector) {
+    selectorsToExpression(out, m_yearSelectors);
+    if (!m_monthdaySelectors.empty()) {
         maybeSpace();
-        expr += m_monthdaySelector->toExpression({});
+        selectorsToExpression(out, m_monthdaySelectors);
     }
-    if (m_weekSelector) {
+    if (!m_weekSelectors.empty()) {
         maybeSpace();
-        expr += "week " + m_weekSelector->toExpression();
+        out += "week ";
+        selectorsToExpression(out, m_weekSelectors);
     }
     if (!m_wideRangeSelectorComment.isEmpty()) {
-        expr += '"' + m_wideRangeSelectorComment.toUtf8() + '"';
+        out += '"';
+        out += m_wideRangeSelectorComment;
+        out += '"';
     }
     if (m_colonAfterWideRangeSelector) {
-        expr += ':';
+        out += ':';
     }
     if (m_weekdaySelector) {
         maybeSpace();
-        expr += m_weekdaySelector->toExpression();
+        m_weekdaySelector->toExpression(out);
     }
-    if (m_timeSelector) {
+    if (!m_timeSelectors.empty()) {
         maybeSpace();
-        expr += m_timeSelector->toExpression();
+        selectorsToExpression(out, m_timeSelectors);
     }
     switch (m_state) {
     case Interval::Open:
         maybeSpace();
-        expr += "open";
+        out += "open";
         break;
     case Interval::Closed:
         maybeSpace();
-        expr += m_stateFlags & Off ? "off" : "closed";
+        out += m_stateFlags & Off ? "off" : "closed";
         break;
     case Interval::Unknown:
         maybeSpace();
-        expr += "unknown";
+        out += "unknown";
         break;
     case Interval::Invalid:
         break;
     }
     if (!m_comment.isEmpty()) {
-        if (!expr.isEmpty()) {
-            expr += ' ';
-        }
-        expr += '"' + m_comment.toUtf8() + '"';
+        maybeSpace();
+        out += '"';
+        Utf8::append(out, m_comment);
+        out += '"';
     }
-    return expr;
 }
 
 int Rule::selectorCount() const
 {
-    const auto selectors = { (bool)m_yearSelector, (bool)m_monthdaySelector, (bool)m_weekSelector, (bool)m_weekdaySelector, (bool)m_timeSelector };
+    const auto selectors = { !m_yearSelectors.empty(), !m_monthdaySelectors.empty(), !m_weekSelectors.empty(), (bool)m_weekdaySelector, !m_timeSelectors.empty() };
     return std::count(std::begin(selectors), std::end(selectors), true);
 }
+
+std::unique_ptr<Rule> Rule::clone() const
+{
+    std::unique_ptr<Rule> rule(new Rule);
+    rule->m_comment = m_comment;
+    rule->m_wideRangeSelectorComment = m_wideRangeSelectorComment;
+    rule->m_timeSelectors = m_timeSelectors;
+    rule->m_weekdaySelector = m_weekdaySelector ? m_weekdaySelector->clone() : std::unique_ptr<WeekdayRange>();
+    rule->m_weekSelectors = m_weekSelectors;
+    rule->m_monthdaySelectors = m_monthdaySelectors;
+    rule->m_yearSelectors = m_yearSelectors;
+    rule->m_seen_24_7 = m_seen_24_7;
+    rule->m_colonAfterWideRangeSelector = m_colonAfterWideRangeSelector;
+    rule->m_stateFlags = m_stateFlags;
+    rule->m_ruleType = m_ruleType;
+    rule->m_state = m_state;
+    return rule;
+}
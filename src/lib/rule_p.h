@@ -12,6 +12,7 @@
 
 
 #include <memory>
+#include <vector>
 
 namespace KOpeningHours {
 
@@ -36,7 +37,7 @@ public:
 };
 
 /** Opening hours expression rule. */
-class Rule
+class Rule : public ArenaAllocated
 {
 public:
     enum Type : short {
@@ -63,19 +64,24 @@ public:
     bool hasWideRangeSelector() const;
 
     RuleResult nextInterval(const QDateTime &dt, OpeningHoursPrivate *context) const;
-    QByteArray toExpression() const;
+    /** Appends the expression for this rule to @p out. */
+    void toExpression(QByteArray &out) const;
 
     /** Amount of selectors for this rule. */
     int selectorCount() const;
+    /** Deep copy of this rule and all its selectors. */
+    std::unique_ptr<Rule> clone() const;
 
     QString m_comment;
-    QString m_wideRangeSelectorComment;
+    QByteArray m_wideRangeSelectorComment;
 
-    std::unique_ptr<Timespan> m_timeSelector;
+    // selectors in the order they appear in the expression, stored contiguously for evaluation
+    // weekday selectors are trees rather than lists, those remain linked
+    std::vector<Timespan> m_timeSelectors;
     std::unique_ptr<WeekdayRange> m_weekdaySelector;
-    std::unique_ptr<Week> m_weekSelector;
-    std::unique_ptr<MonthdayRange> m_monthdaySelector;
-    std::unique_ptr<YearRange> m_yearSelector;
+    std::vector<Week> m_weekSelectors;
+    std::vector<MonthdayRange> m_monthdaySelectors;
+    std::vector<YearRange> m_yearSelectors;
     bool m_seen_24_7 = false;
     bool m_colonAfterWideRangeSelector = false;
 
@@ -85,8 +91,19 @@ public:
 private:
     Interval::State m_state = Interval::Invalid;
 
-    enum { RecursionLimit = 64 };
-    RuleResult nextInterval(const QDateTime &dt, OpeningHoursPrivate *context, int recursionBudget) const;
+    /** Upper bound for how often evaluation moves on to the next possible match of a selector.
+     *  Selectors skip directly to their next possible match, so the sparsest rules are those
+     *  combining a month with an nth weekday (e.g. "Feb Mo[5]"). Those take two steps per year
+     *  without a match and match at least every 40 years, ie. within about 80 steps.
+     *  Rules still not matching after this many steps are reported as an evaluation error.
+     */
+    enum { MaximumSteps = 128 };
+    RuleResult findNextInterval(QDateTime dt, OpeningHoursPrivate *context) const;
+    /** Evaluates all selectors at @p dt.
+     *  @returns the combined interval if all selectors match, otherwise the result of the first
+     *  selector not matching, with @p isTimeSelectorOffset set if that is a time selector.
+     */
+    SelectorResult matchSelectors(const QDateTime &dt, OpeningHoursPrivate *context, bool &isTimeSelectorOffset) const;
 };
 
 }
@@ -8,18 +8,92 @@
 #include "logging.h"
 #include "openinghours_p.h"
 
+#include <charconv>
 #include <cstdlib>
 #include <cassert>
 
 using namespace KOpeningHours;
 
-static QByteArray twoDigits(int n)
+static void appendNumber(QByteArray &out, int n)
 {
-    QByteArray ret = QByteArray::number(n);
-    if (ret.size() < 2) {
-        ret.prepend('0');
+    char buffer[16];
+    const auto result = std::to_chars(std::begin(buffer), std::end(buffer), n);
+    out.append(buffer, result.ptr - buffer);
+}
+
+static void appendTwoDigits(QByteArray &out, int n)
+{
+    if (n >= 0 && n < 10) {
+        out += '0';
+    }
+    appendNumber(out, n);
+}
+
+static void appendDayOffset(QByteArray &out, int offset)
+{
+    if (offset > 0) {
+        out += " +";
+        appendNumber(out, offset);
+        out += offset > 1 ? " days" : " day";
+    } else if (offset < 0) {
+        out += " -";
+        appendNumber(out, -offset);
+        out += offset < -1 ? " days" : " day";
+    }
+}
+
+static constexpr std::size_t hashCombine(std::size_t seed, std::size_t value)
+{
+    // same as boost::hash_combine
+    return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+template <typename T>
+static bool optionalEquals(const std::unique_ptr<T> &lhs, const std::unique_ptr<T> &rhs)
+{
+    return lhs ? (rhs && *lhs == *rhs) : !rhs;
+}
+
+/** Compares two selector lists, using @p equals for the individual list elements. */
+template <typename T, typename Equals>
+static bool listEquals(const T *lhs, const T *rhs, Equals equals)
+{
+    for (; lhs && rhs; lhs = lhs->next.get(), rhs = rhs->next.get()) {
+        if (!equals(*lhs, *rhs)) {
+            return false;
+        }
+    }
+    return !lhs && !rhs;
+}
+
+/** Deep copy of a selector list, using @p copy for the individual list elements. */
+template <typename T, typename Copy>
+static std::unique_ptr<T> cloneList(const T *selector, Copy copy)
+{
+    std::unique_ptr<T> head;
+    auto tail = &head;
+    for (; selector; selector = selector->next.get()) {
+        tail->reset(new T(copy(*selector)));
+        tail = &(*tail)->next;
     }
-    return ret;
+    return head;
+}
+
+/** Hashes a selector list, using @p hash for the individual list elements. */
+template <typename T, typename Hash>
+static std::size_t listHash(const T *selector, std::size_t seed, Hash hash)
+{
+    for (; selector; selector = selector->next.get()) {
+        seed = hashCombine(seed, hash(*selector));
+    }
+    return seed;
+}
+
+std::size_t KOpeningHours::qHash(Time time, std::size_t seed)
+{
+    seed = hashCombine(seed, time.event);
+    seed = hashCombine(seed, time.hour);
+    return hashCombine(seed, time.minute);
 }
 
 bool Time::isValid(Time t)
@@ -60,33 +134,44 @@ Time Time::parse(const char *begin, const char *end)
     return t;
 }
 
-QByteArray Time::toExpression(bool end) const
+void Time::toExpression(QByteArray &out, bool end) const
 {
-    QByteArray expr;
+    const char *eventName = nullptr;
     switch (event) {
     case Time::NoEvent:
-        if (hour % 24 == 0 && minute == 0 && end)
-            return "24:00";
-        return twoDigits(hour) + ':' + twoDigits(minute);
+        if (hour % 24 == 0 && minute == 0 && end) {
+            out += "24:00";
+        } else {
+            appendTwoDigits(out, hour);
+            out += ':';
+            appendTwoDigits(out, minute);
+        }
+        return;
     case Time::Dawn:
-        expr = "dawn";
+        eventName = "dawn";
         break;
     case Time::Sunrise:
-        expr = "sunrise";
+        eventName = "sunrise";
         break;
     case Time::Dusk:
-        expr = "dusk";
+        eventName = "dusk";
         break;
     case Time::Sunset:
-        expr = "sunset";
+        eventName = "sunset";
         break;
     }
     const int minutes = hour * 60 + minute;
-    if (minutes != 0) {
-        const QByteArray hhmm = twoDigits(qAbs(hour)) + ':' + twoDigits(qAbs(minute));
-        expr = '(' + expr + (minutes > 0 ? '+' : '-') + hhmm + ')';
-    }
-    return expr;
+    if (minutes == 0) {
+        out += eventName;
+        return;
+    }
+    out += '(';
+    out += eventName;
+    out += minutes > 0 ? '+' : '-';
+    appendTwoDigits(out, qAbs(hour));
+    out += ':';
+    appendTwoDigits(out, qAbs(minute));
+    out += ')';
 }
 
 int Timespan::requiredCapabilities() const
@@ -100,36 +185,36 @@ int Timespan::requiredCapabilities() const
     if (begin.event != Time::NoEvent || end.event != Time::NoEvent) {
         c |= Capability::Location;
     }
-    return next ? (next->requiredCapabilities() | c) : c;
+    return c;
 }
 
-static QByteArray intervalToExpression(int minutes)
+static void appendInterval(QByteArray &out, int minutes)
 {
     if (minutes < 60) {
-        return twoDigits(minutes);
+        appendTwoDigits(out, minutes);
     } else {
         const int hours = minutes / 60;
         minutes -= hours * 60;
-        return twoDigits(hours) + ':' + twoDigits(minutes);
+        appendTwoDigits(out, hours);
+        out += ':';
+        appendTwoDigits(out, minutes);
     }
 }
 
-QByteArray Timespan::toExpression() const
+void Timespan::toExpression(QByteArray &out) const
 {
-    QByteArray expr = begin.toExpression(false);
+    begin.toExpression(out, false);
     if (!pointInTime) {
-        expr += '-' + end.toExpression(true);
+        out += '-';
+        end.toExpression(out, true);
     }
     if (openEnd) {
-        expr += '+';
+        out += '+';
     }
     if (interval) {
-        expr += '/' + intervalToExpression(interval);
+        out += '/';
+        appendInterval(out, interval);
     }
-    if (next) {
-        expr += ',' + next->toExpression();
-    }
-    return expr;
 }
 
 Time Timespan::adjustedEnd() const
@@ -140,14 +225,20 @@ Time Timespan::adjustedEnd() const
     return end;
 }
 
-bool Timespan::operator==(Timespan &other) const
+bool Timespan::operator==(const Timespan &other) const
+{
+    return begin == other.begin
+        && end == other.end
+        && openEnd == other.openEnd
+        && pointInTime == other.pointInTime
+        && interval == other.interval;
+}
+
+std::size_t KOpeningHours::qHash(const Timespan &selector, std::size_t seed)
 {
-    return begin == other.begin &&
-            end == other.end &&
-            openEnd == other.openEnd &&
-            interval == other.interval &&
-            bool(next) == (bool)other.next &&
-            (!next || *next == *other.next);
+    auto h = qHash(selector.begin, qHash(selector.end));
+    h = hashCombine(h, selector.interval);
+    return hashCombine(seed, hashCombine(h, selector.openEnd | (selector.pointInTime << 1)));
 }
 
 int WeekdayRange::requiredCapabilities() const
@@ -178,41 +269,89 @@ int WeekdayRange::requiredCapabilities() const
 
 static constexpr const char* s_weekDays[] = { "ERROR", "Mo", "Tu", "We", "Th", "Fr", "Sa", "Su"};
 
-QByteArray WeekdayRange::toExpression() const
+void WeekdayRange::toExpression(QByteArray &out) const
 {
-    QByteArray expr;
-    if (lhsAndSelector && rhsAndSelector) {
-        expr = lhsAndSelector->toExpression() + ' ' + rhsAndSelector->toExpression();
-    } else {
-        switch (holiday) {
+    for (auto w = this; w; w = w->next.get()) {
+        if (w != this) {
+            out += ',';
+        }
+        if (w->lhsAndSelector && w->rhsAndSelector) {
+            w->lhsAndSelector->toExpression(out);
+            out += ' ';
+            w->rhsAndSelector->toExpression(out);
+            continue;
+        }
+        switch (w->holiday) {
         case NoHoliday: {
-            expr = s_weekDays[beginDay];
-            if (endDay != beginDay) {
-                expr += '-';
-                expr += s_weekDays[endDay];
+            out += s_weekDays[w->beginDay];
+            if (w->endDay != w->beginDay) {
+                out += '-';
+                out += s_weekDays[w->endDay];
             }
             break;
         }
         case PublicHoliday:
-            expr = "PH";
+            out += "PH";
             break;
         case SchoolHoliday:
-            expr = "SH";
+            out += "SH";
             break;
         }
-        if (nthSequence) {
-            expr += '[' + nthSequence->toExpression() + ']';
-        }
-        if (offset > 0) {
-            expr += " +" + QByteArray::number(offset) + ' ' + (offset > 1 ? "days" : "day");
-        } else if (offset < 0) {
-            expr += " -" + QByteArray::number(-offset) + ' ' + (offset < -1 ? "days" : "day");
+        if (w->nthSequence) {
+            out += '[';
+            w->nthSequence->toExpression(out);
+            out += ']';
         }
+        appendDayOffset(out, w->offset);
     }
-    if (next) {
-        expr += ',' + next->toExpression();
-    }
-    return expr;
+}
+
+bool WeekdayRange::operator==(const WeekdayRange &other) const
+{
+    return listEquals(this, &other, [](const WeekdayRange &lhs, const WeekdayRange &rhs) {
+        return lhs.beginDay == rhs.beginDay
+            && lhs.endDay == rhs.endDay
+            && lhs.offset == rhs.offset
+            && lhs.holiday == rhs.holiday
+            && optionalEquals(lhs.nthSequence, rhs.nthSequence)
+            && optionalEquals(lhs.lhsAndSelector, rhs.lhsAndSelector)
+            && optionalEquals(lhs.rhsAndSelector, rhs.rhsAndSelector);
+    });
+}
+
+std::size_t KOpeningHours::qHash(const WeekdayRange &selector, std::size_t seed)
+{
+    return listHash(&selector, seed, [](const WeekdayRange &w) {
+        auto h = hashCombine(w.beginDay | (w.endDay << 4) | (w.holiday << 8), w.offset);
+        if (w.nthSequence) {
+            h = qHash(*w.nthSequence, h);
+        }
+        if (w.lhsAndSelector && w.rhsAndSelector) {
+            h = qHash(*w.rhsAndSelector, qHash(*w.lhsAndSelector, h));
+        }
+        return h;
+    });
+}
+
+std::unique_ptr<WeekdayRange> WeekdayRange::clone() const
+{
+    return cloneList(this, [](const WeekdayRange &w) {
+        WeekdayRange copy;
+        copy.beginDay = w.beginDay;
+        copy.endDay = w.endDay;
+        if (w.nthSequence) {
+            copy.nthSequence.reset(new NthSequence(*w.nthSequence));
+        }
+        copy.offset = w.offset;
+        copy.holiday = w.holiday;
+        if (w.lhsAndSelector) {
+            copy.lhsAndSelector = w.lhsAndSelector->clone();
+        }
+        if (w.rhsAndSelector) {
+            copy.rhsAndSelector = w.rhsAndSelector->clone();
+        }
+        return copy;
+    });
 }
 
 void WeekdayRange::simplify()
@@ -318,39 +457,45 @@ int Week::requiredCapabilities() const
     if (endWeek < beginWeek) { // is this even officially allowed?
         return Capability::NotImplemented;
     }
-    return next ? next->requiredCapabilities() : Capability::None;
+    return Capability::None;
 }
 
-QByteArray Week::toExpression() const
+void Week::toExpression(QByteArray &out) const
 {
-    QByteArray expr = twoDigits(beginWeek);
+    appendTwoDigits(out, beginWeek);
     if (endWeek != beginWeek) {
-        expr += '-';
-        expr += twoDigits(endWeek);
+        out += '-';
+        appendTwoDigits(out, endWeek);
     }
     if (interval > 1) {
-        expr += '/';
-        expr += QByteArray::number(interval);
-    }
-    if (next) {
-        expr += ',' + next->toExpression();
+        out += '/';
+        appendNumber(out, interval);
     }
-    return expr;
 }
 
-QByteArray Date::toExpression(const Date &refDate, const MonthdayRange &prev) const
+bool Week::operator==(const Week &other) const
+{
+    return beginWeek == other.beginWeek && endWeek == other.endWeek && interval == other.interval;
+}
+
+std::size_t KOpeningHours::qHash(const Week &selector, std::size_t seed)
 {
-    QByteArray expr;
+    return hashCombine(seed, std::size_t(selector.beginWeek | (selector.endWeek << 8) | (selector.interval << 16)));
+}
+
+void Date::toExpression(QByteArray &out, const Date &refDate, const MonthdayRange &prev) const
+{
+    const auto startSize = out.size();
     auto maybeSpace = [&]() {
-        if (!expr.isEmpty()) {
-            expr += ' ';
+        if (out.size() != startSize) {
+            out += ' ';
         }
     };
     switch (variableDate) {
     case FixedDate: {
         const bool needYear = year && (year != refDate.year || (day && month && month != refDate.month));
         if (needYear) {
-            expr += QByteArray::number(year);
+            appendNumber(out, year);
         }
         if (month) {
             const bool combineWithPrev = prev.begin.month == prev.end.month && month == prev.begin.month;
@@ -358,35 +503,32 @@ QByteArray Date::toExpression(const Date &refDate, const MonthdayRange &prev) co
             if (needYear || !implicitMonth || hasOffset()) {
                 static const char* s_monthName[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
                 maybeSpace();
-                expr += s_monthName[month-1];
+                out += s_monthName[month-1];
             }
         }
         if (day && *this != refDate) {
             maybeSpace();
-            expr += twoDigits(day);
+            appendTwoDigits(out, day);
         }
         break;
     }
     case Date::Easter:
         if (year) {
-            expr += QByteArray::number(year) + ' ';
+            appendNumber(out, year);
+            out += ' ';
         }
-        expr += "easter";
+        out += "easter";
         break;
     }
 
     if (offset.nthWeekday) {
-        expr += ' ';
-        expr += s_weekDays[offset.weekday];
-        expr += '[' + QByteArray::number(offset.nthWeekday) + ']';
+        out += ' ';
+        out += s_weekDays[offset.weekday];
+        out += '[';
+        appendNumber(out, offset.nthWeekday);
+        out += ']';
     }
-
-    if (offset.dayOffset > 0) {
-        expr += " +" + QByteArray::number(offset.dayOffset) + ' ' + (offset.dayOffset > 1 ? "days" : "day");
-    } else if (offset.dayOffset < 0) {
-        expr += " -" + QByteArray::number(-offset.dayOffset) + ' ' + (offset.dayOffset < -1 ? "days" : "day");
-    }
-    return expr;
+    appendDayOffset(out, offset.dayOffset);
 }
 
 bool DateOffset::operator==(DateOffset other) const
@@ -418,6 +560,19 @@ bool Date::operator==(Date other) const
     return offset == other.offset;
 }
 
+std::size_t KOpeningHours::qHash(Date date, std::size_t seed)
+{
+    // consistent with Date::operator==, which ignores the fixed date fields for variable dates
+    seed = hashCombine(seed, date.variableDate);
+    if (date.variableDate == Date::FixedDate) {
+        seed = hashCombine(seed, date.year);
+        seed = hashCombine(seed, date.month);
+        seed = hashCombine(seed, date.day);
+    }
+    seed = hashCombine(seed, date.offset.dayOffset);
+    return hashCombine(seed, (uint8_t)date.offset.weekday | ((uint8_t)date.offset.nthWeekday << 8));
+}
+
 bool Date::hasOffset() const
 {
     return offset.dayOffset || offset.weekday;
@@ -428,16 +583,13 @@ int MonthdayRange::requiredCapabilities() const
     return Capability::None;
 }
 
-QByteArray MonthdayRange::toExpression(const MonthdayRange &prev) const
+void MonthdayRange::toExpression(QByteArray &out, const MonthdayRange &prev) const
 {
-    QByteArray expr = begin.toExpression({}, prev);
+    begin.toExpression(out, {}, prev);
     if (end != begin) {
-        expr += '-' + end.toExpression(begin, prev);
-    }
-    if (next) {
-        expr += ',' + next->toExpression(*this);
+        out += '-';
+        end.toExpression(out, begin, prev);
     }
-    return expr;
 }
 
 void MonthdayRange::simplify()
@@ -458,28 +610,44 @@ void MonthdayRange::simplify()
     }
 }
 
+bool MonthdayRange::operator==(const MonthdayRange &other) const
+{
+    return begin == other.begin && end == other.end;
+}
+
+std::size_t KOpeningHours::qHash(const MonthdayRange &selector, std::size_t seed)
+{
+    return hashCombine(seed, qHash(selector.end, qHash(selector.begin)));
+}
+
 int YearRange::requiredCapabilities() const
 {
     return Capability::None;
 }
 
-QByteArray YearRange::toExpression() const
+void YearRange::toExpression(QByteArray &out) const
 {
-    QByteArray expr = QByteArray::number(begin);
+    appendNumber(out, begin);
     if (end == 0 && interval == 1) {
-        expr += '+';
+        out += '+';
     } else if (end != begin && end != 0) {
-        expr += '-';
-        expr += QByteArray::number(end);
+        out += '-';
+        appendNumber(out, end);
     }
     if (interval > 1) {
-        expr += '/';
-        expr += QByteArray::number(interval);
+        out += '/';
+        appendNumber(out, interval);
     }
-    if (next) {
-        expr += ',' + next->toExpression();
-    }
-    return expr;
+}
+
+bool YearRange::operator==(const YearRange &other) const
+{
+    return begin == other.begin && end == other.end && interval == other.interval;
+}
+
+std::size_t KOpeningHours::qHash(const YearRange &selector, std::size_t seed)
+{
+    return hashCombine(seed, hashCombine(hashCombine(selector.begin, selector.end), selector.interval));
 }
 
 void NthSequence::add(NthEntry range)
@@ -487,20 +655,29 @@ void NthSequence::add(NthEntry range)
     sequence.push_back(std::move(range));
 }
 
-QByteArray NthSequence::toExpression() const
+std::size_t KOpeningHours::qHash(const NthSequence &sequence, std::size_t seed)
 {
-    QByteArray ret;
-    for (const NthEntry &entry : sequence) {
-        if (!ret.isEmpty())
-            ret += ',';
-        ret += entry.toExpression();
+    for (const NthEntry &entry : sequence.sequence) {
+        seed = hashCombine(hashCombine(seed, entry.begin), entry.end);
     }
-    return ret;
+    return seed;
 }
 
-QByteArray NthEntry::toExpression() const
+void NthSequence::toExpression(QByteArray &out) const
 {
-    if (begin == end)
-        return QByteArray::number(begin);
-    return QByteArray::number(begin) + '-' + QByteArray::number(end);
+    for (auto it = sequence.begin(); it != sequence.end(); ++it) {
+        if (it != sequence.begin()) {
+            out += ',';
+        }
+        (*it).toExpression(out);
+    }
+}
+
+void NthEntry::toExpression(QByteArray &out) const
+{
+    appendNumber(out, begin);
+    if (begin != end) {
+        out += '-';
+        appendNumber(out, end);
+    }
 }
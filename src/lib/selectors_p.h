@@ -7,9 +7,11 @@
 #ifndef KOPENINGHOURS_SELECTORS_P_H
 #define KOPENINGHOURS_SELECTORS_P_H
 
+#include "arena_p.h"
 #include "interval.h"
 
 #include <memory>
+#include <vector>
 
 namespace KOpeningHours {
 
@@ -61,6 +63,8 @@ private:
 };
 
 // see https://wiki.openstreetmap.org/wiki/Key:opening_hours/specification, the below names/types follow that
+// toExpression() methods append to the given buffer, for weekday selectors that includes all following selectors in the list
+// time, week, monthday and year selectors are stored in std::vector instead, see Rule
 
 template <typename T>
 void appendSelector(T* firstSelector, std::unique_ptr<T> &&selector)
@@ -86,6 +90,29 @@ T* lastSelector(T* firstSelector)
     return firstSelector;
 }
 
+/** Appends to selector lists without walking the entire list on every append.
+ *  This remembers where the list it last appended to ended, so it must not be used
+ *  anymore once selectors are removed from any list it was used on.
+ */
+template <typename T>
+class SelectorAppender
+{
+public:
+    void append(T *firstSelector, std::unique_ptr<T> &&selector)
+    {
+        if (m_first != firstSelector) {
+            m_first = firstSelector;
+            m_last = firstSelector;
+        }
+        m_last = lastSelector(m_last);
+        m_last->next = std::move(selector);
+    }
+
+private:
+    T *m_first = nullptr;
+    T *m_last = nullptr;
+};
+
 /** Time */
 class Time
 {
@@ -94,7 +121,7 @@ public:
     static void convertFromAm(Time &t);
     static void convertFromPm(Time &t);
     static Time parse(const char *begin, const char *end);
-    QByteArray toExpression(bool end) const;
+    void toExpression(QByteArray &out, bool end) const;
 
     enum Event {
         NoEvent,
@@ -116,6 +143,31 @@ inline constexpr bool operator==(Time lhs, Time rhs)
         && lhs.minute == rhs.minute;
 }
 
+// Selector equality and hashing is structural, for weekday selectors that covers the entire
+// selector list starting at the given selector. Hashes are stable across runs, ie. not randomly seeded.
+std::size_t qHash(Time time, std::size_t seed = 0);
+
+/** Hash of all selectors in @p selectors, in order. */
+template <typename T>
+std::size_t qHash(const std::vector<T> &selectors, std::size_t seed = 0)
+{
+    for (const auto &selector : selectors) {
+        seed = qHash(selector, seed);
+    }
+    return seed;
+}
+
+/** Combined capabilities required by all selectors in @p selectors. */
+template <typename T>
+int requiredCapabilities(const std::vector<T> &selectors)
+{
+    int c = Capability::None;
+    for (const auto &selector : selectors) {
+        c |= selector.requiredCapabilities();
+    }
+    return c;
+}
+
 /** Time span selector. */
 class Timespan
 {
@@ -123,42 +175,50 @@ public:
     int requiredCapabilities() const;
     bool isMultiDay(QDate date, OpeningHoursPrivate *context) const;
     SelectorResult nextInterval(const Interval &interval, const QDateTime &dt, OpeningHoursPrivate *context) const;
-    QByteArray toExpression() const;
+    void toExpression(QByteArray &out) const;
     Time adjustedEnd() const;
-    bool operator==(Timespan &other) const;
+    bool operator==(const Timespan &other) const;
 
     Time begin = { Time::NoEvent, -1, -1 };
     Time end = { Time::NoEvent, -1, -1 };
     int interval = 0;
     bool openEnd = false;
     bool pointInTime = false;
-    std::unique_ptr<Timespan> next;
 };
 
+std::size_t qHash(const Timespan &selector, std::size_t seed = 0);
+
 struct NthEntry {
     int begin;
     int end;
-    QByteArray toExpression() const;
+    void toExpression(QByteArray &out) const;
+    bool operator==(NthEntry other) const { return begin == other.begin && end == other.end; }
 };
 
 /** Nth week days, like 1-2,4,6-8 */
-class NthSequence
+class NthSequence : public ArenaAllocated
 {
 public:
     void add(NthEntry range);
-    QByteArray toExpression() const;
+    void toExpression(QByteArray &out) const;
+    bool operator==(const NthSequence &other) const { return sequence == other.sequence; }
     std::vector<NthEntry> sequence;
 };
 
+std::size_t qHash(const NthSequence &sequence, std::size_t seed = 0);
+
 /** Weekday range. */
-class WeekdayRange
+class WeekdayRange : public ArenaAllocated
 {
 public:
     int requiredCapabilities() const;
     SelectorResult nextInterval(const Interval &interval, const QDateTime &dt, OpeningHoursPrivate *context) const;
     SelectorResult nextIntervalLocal(const Interval &interval, const QDateTime &dt, OpeningHoursPrivate *context) const;
-    QByteArray toExpression() const;
+    void toExpression(QByteArray &out) const;
     void simplify();
+    bool operator==(const WeekdayRange &other) const;
+    /** Deep copy of this selector, including the following selectors in the list. */
+    std::unique_ptr<WeekdayRange> clone() const;
 
     uint8_t beginDay = 0; // Mo=1, Tu=2, ..., Su=7
     uint8_t endDay = 0;
@@ -175,20 +235,24 @@ public:
     std::unique_ptr<WeekdayRange> rhsAndSelector;
 };
 
+std::size_t qHash(const WeekdayRange &selector, std::size_t seed = 0);
+
 /** Week */
 class Week
 {
 public:
     int requiredCapabilities() const;
     SelectorResult nextInterval(const Interval &interval, const QDateTime &dt, OpeningHoursPrivate *context) const;
-    QByteArray toExpression() const;
+    void toExpression(QByteArray &out) const;
+    bool operator==(const Week &other) const;
 
     uint8_t beginWeek = 0;
     uint8_t endWeek = 0;
     uint8_t interval = 1;
-    std::unique_ptr<Week> next;
 };
 
+std::size_t qHash(const Week &selector, std::size_t seed = 0);
+
 /** Day or weekday-based offset to a Date. */
 class DateOffset
 {
@@ -207,7 +271,7 @@ class MonthdayRange;
 class Date
 {
 public:
-    QByteArray toExpression(const Date &refDate, const MonthdayRange &prev) const;
+    void toExpression(QByteArray &out, const Date &refDate, const MonthdayRange &prev) const;
     bool operator==(Date other) const;
     bool operator!=(Date other) const { return !operator==(other); }
     bool hasOffset() const;
@@ -223,33 +287,39 @@ public:
     DateOffset offset;
 };
 
+std::size_t qHash(Date date, std::size_t seed = 0);
+
 /** Monthday range. */
 class MonthdayRange
 {
 public:
     int requiredCapabilities() const;
     SelectorResult nextInterval(const Interval &interval, const QDateTime &dt, OpeningHoursPrivate *context) const;
-    QByteArray toExpression(const MonthdayRange &prev) const;
+    void toExpression(QByteArray &out, const MonthdayRange &prev) const;
     void simplify();
+    bool operator==(const MonthdayRange &other) const;
 
     Date begin = { 0, 0, 0, Date::FixedDate, { 0, 0, 0 } };
     Date end = { 0, 0, 0, Date::FixedDate, { 0, 0, 0 } };
-    std::unique_ptr<MonthdayRange> next;
 };
 
+std::size_t qHash(const MonthdayRange &selector, std::size_t seed = 0);
+
 /** Year range. */
 class YearRange
 {
 public:
     int requiredCapabilities() const;
     SelectorResult nextInterval(const Interval &interval, const QDateTime &dt, OpeningHoursPrivate *context) const;
-    QByteArray toExpression() const;
+    void toExpression(QByteArray &out) const;
+    bool operator==(const YearRange &other) const;
 
     int begin = 0;
     int end = 0;
     int interval = 1;
-    std::unique_ptr<YearRange> next;
 };
+
+std::size_t qHash(const YearRange &selector, std::size_t seed = 0);
 }
 
 #endif // KOPENINGHOURS_SELECTORS_P_H
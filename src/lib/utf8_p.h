@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_UTF8_P_H
+#define KOPENINGHOURS_UTF8_P_H
+
+#include <QByteArray>
+#include <QChar>
+#include <QString>
+
+namespace KOpeningHours {
+
+/** UTF-16 to UTF-8 conversion into existing buffers.
+ *  This is the same as QString::toUtf8(), without the temporary QByteArray.
+ */
+namespace Utf8
+{
+    /** Maximum number of UTF-8 bytes for @p size UTF-16 code units. */
+    template <typename T>
+    constexpr T maximumSize(T size)
+    {
+        return size * 3;
+    }
+
+    /** Writes the UTF-8 representation of [@p begin, @p end) to @p out.
+     *  @p out needs to have room for at least maximumSize() bytes.
+     *  @returns the end of the written data.
+     */
+    inline char *encode(const QChar *begin, const QChar *end, char *out)
+    {
+        for (auto it = begin; it != end; ++it) {
+            uint c = it->unicode();
+            if (c < 0x80) {
+                *out++ = char(c);
+                continue;
+            }
+            if (c < 0x800) {
+                *out++ = char(0xC0 | (c >> 6));
+                *out++ = char(0x80 | (c & 0x3F));
+                continue;
+            }
+            if (QChar::isHighSurrogate(c) && it + 1 != end && QChar::isLowSurrogate((it + 1)->unicode())) {
+                c = QChar::surrogateToUcs4(c, (++it)->unicode());
+                *out++ = char(0xF0 | (c >> 18));
+                *out++ = char(0x80 | ((c >> 12) & 0x3F));
+                *out++ = char(0x80 | ((c >> 6) & 0x3F));
+                *out++ = char(0x80 | (c & 0x3F));
+                continue;
+            }
+            if (QChar::isSurrogate(c)) {
+                c = QChar::ReplacementCharacter;
+            }
+            *out++ = char(0xE0 | (c >> 12));
+            *out++ = char(0x80 | ((c >> 6) & 0x3F));
+            *out++ = char(0x80 | (c & 0x3F));
+        }
+        return out;
+    }
+
+    /** Appends the UTF-8 representation of @p str to @p out. */
+    inline void append(QByteArray &out, const QString &str)
+    {
+        const auto offset = out.size();
+        out.resize(offset + maximumSize(str.size()));
+        const auto end = encode(str.constData(), str.constData() + str.size(), out.data() + offset);
+        out.resize(end - out.constData());
+    }
+}
+
+}
+
+#endif // KOPENINGHOURS_UTF8_P_H
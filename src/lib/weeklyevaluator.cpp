@@ -0,0 +1,265 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#include "weeklyevaluator_p.h"
+#include "civildate_p.h"
+#include "fastpath_p.h"
+#include "rule_p.h"
+
+#include <QDateTime>
+
+#include <algorithm>
+#include <limits>
+
+using namespace KOpeningHours;
+
+enum {
+    MinutesPerDay = 24 * 60,
+    // Rule::nextInterval() starts over whenever a selector doesn't match, for the rules supported
+    // here that ends after at most four steps (next matching day, next time span, and the same
+    // again for the following day), this is just a safety net
+    MaximumSteps = 8,
+    // range of days around the requested date that evaluation can look at: matching weekday ranges
+    // start up to six days earlier, closed rules are evaluated from the start of the open interval,
+    // and the next match of a weekday range can begin a week later and last another week
+    LookBehindDays = 7,
+    LookAheadDays = 23,
+};
+
+static qint64 dayOf(qint64 minute)
+{
+    return minute / MinutesPerDay;
+}
+
+static QDateTime toDateTime(qint64 minute)
+{
+    const int minuteOfDay = minute % MinutesPerDay;
+    return QDateTime(QDate::fromJulianDay(dayOf(minute)), QTime(minuteOfDay / 60, minuteOfDay % 60));
+}
+
+/** The full evaluator moves through time in seconds, while we use local wall-clock minutes.
+ *  Those are only equivalent if the UTC offset doesn't change in the range of days evaluation
+ *  looks at. This assumes there are no two offset changes cancelling each other out within that range.
+ */
+static bool hasConstantUtcOffset(QDate date)
+{
+    return QDateTime(date.addDays(-LookBehindDays), {0, 0}).offsetFromUtc() == QDateTime(date.addDays(LookAheadDays), {0, 0}).offsetFromUtc();
+}
+
+std::shared_ptr<const WeeklyEvaluator> WeeklyEvaluator::compile(const std::vector<std::shared_ptr<Rule>> &rules)
+{
+    if (!isFastPathEnabled(FastPath::WeeklyEvaluator) || rules.empty()) {
+        return {};
+    }
+
+    std::shared_ptr<WeeklyEvaluator> evaluator(new WeeklyEvaluator);
+    for (const auto &rule : rules) {
+        CompiledRule compiled;
+        if (!compileRule(*rule, compiled)) {
+            return {};
+        }
+        if (compiled.state == Interval::Closed) {
+            evaluator->m_closedRules.push_back(std::move(compiled));
+        } else {
+            evaluator->m_openRules.push_back(std::move(compiled));
+        }
+    }
+
+    // expressions without open rules produce invalid intervals, leave those to the full evaluator
+    if (evaluator->m_openRules.empty()) {
+        return {};
+    }
+    return evaluator;
+}
+
+bool WeeklyEvaluator::compileRule(const Rule &rule, CompiledRule &compiled)
+{
+    // fallback rules and rules without any selectors (such as 24/7) are cheap to evaluate already
+    if ((rule.m_ruleType != Rule::NormalRule && rule.m_ruleType != Rule::AdditionalRule)
+        || rule.hasWideRangeSelector() || (!rule.m_weekdaySelector && rule.m_timeSelectors.empty())) {
+        return false;
+    }
+
+    // wrapping weekday ranges (e.g. "Fr-Mo") are left out, as those match differently depending
+    // on which of their days they are evaluated on
+    for (auto s = rule.m_weekdaySelector.get(); s; s = s->next.get()) {
+        if (s->nthSequence || s->offset != 0 || s->holiday != WeekdayRange::NoHoliday || s->lhsAndSelector || s->rhsAndSelector
+            || s->beginDay < 1 || s->beginDay > s->endDay || s->endDay > 7) {
+            return false;
+        }
+        compiled.days.push_back({s->beginDay, s->endDay});
+    }
+
+    // time spans reaching midnight make the full evaluator look at the previous day as well,
+    // those are also left out
+    for (const auto &s : rule.m_timeSelectors) {
+        if (s.begin.event != Time::NoEvent || s.end.event != Time::NoEvent || s.openEnd || s.pointInTime || s.interval != 0
+            || s.begin.hour < 0 || s.begin.hour >= 24 || s.begin.minute < 0 || s.begin.minute >= 60
+            || s.end.hour < 0 || s.end.hour >= 24 || s.end.minute < 0 || s.end.minute >= 60) {
+            return false;
+        }
+        const TimeRange range{ s.begin.hour * 60 + s.begin.minute, s.end.hour * 60 + s.end.minute };
+        if (range.end <= range.begin) {
+            return false;
+        }
+        compiled.times.push_back(range);
+    }
+
+    compiled.state = rule.state();
+    compiled.comment = rule.m_comment;
+    compiled.canOverride = rule.m_ruleType == Rule::NormalRule && compiled.state != Interval::Closed;
+    return true;
+}
+
+/** Same order as Interval::operator<. */
+static bool isBefore(qint64 lhsBegin, qint64 lhsEnd, qint64 rhsBegin, qint64 rhsEnd)
+{
+    return lhsBegin == rhsBegin ? lhsEnd < rhsEnd : lhsBegin < rhsBegin;
+}
+
+// this mirrors Rule::nextInterval() and the selector evaluation, including the choice between
+// multiple matching selectors and the result mode, see there
+bool WeeklyEvaluator::nextMatch(const CompiledRule &rule, qint64 minute, Match &match, bool &isOverride)
+{
+    isOverride = rule.canOverride;
+    for (int step = 0; step < MaximumSteps; ++step) {
+        const auto day = dayOf(minute);
+        match.rule = &rule;
+
+        if (!rule.days.empty()) {
+            const auto weekday = CivilDate::dayOfWeek(day);
+            auto nextDay = std::numeric_limits<qint64>::max();
+            bool found = false;
+            for (const auto &range : rule.days) {
+                if (weekday < range.beginDay) {
+                    nextDay = std::min(nextDay, day + range.beginDay - weekday);
+                } else if (weekday > range.endDay) {
+                    nextDay = std::min(nextDay, day + 7 + range.beginDay - weekday);
+                } else {
+                    const auto begin = (day + range.beginDay - weekday) * MinutesPerDay;
+                    const auto end = begin + (range.endDay - range.beginDay + 1) * MinutesPerDay;
+                    if (!found || isBefore(begin, end, match.begin, match.end)) {
+                        match.begin = begin;
+                        match.end = end;
+                    }
+                    found = true;
+                }
+            }
+            if (!found) {
+                // results found after skipping to a later day never override preceding rules
+                if (step == 0) {
+                    isOverride = false;
+                }
+                minute = nextDay * MinutesPerDay;
+                continue;
+            }
+        }
+
+        if (rule.times.empty()) {
+            return true;
+        }
+
+        auto next = std::numeric_limits<qint64>::max();
+        bool found = false;
+        for (const auto &range : rule.times) {
+            const auto begin = day * MinutesPerDay + range.begin;
+            const auto end = day * MinutesPerDay + range.end;
+            if (begin <= minute && minute < end) {
+                if (!found || isBefore(begin, end, match.begin, match.end)) {
+                    match.begin = begin;
+                    match.end = end;
+                }
+                found = true;
+            } else {
+                next = std::min(next, minute < begin ? begin : begin + MinutesPerDay);
+            }
+        }
+        if (found) {
+            return true;
+        }
+        minute = next;
+    }
+    return false;
+}
+
+// this mirrors the rule combination in OpeningHours::interval(), see there
+bool WeeklyEvaluator::interval(const QDateTime &dt, Interval &result) const
+{
+    const auto date = dt.date();
+    if (!dt.isValid() || date.toJulianDay() < LookBehindDays || !hasConstantUtcOffset(date)) {
+        return false;
+    }
+    const auto time = dt.time();
+    const auto minute = date.toJulianDay() * MinutesPerDay + time.hour() * 60 + time.minute();
+
+    // open rules, there is at least one of those so this always produces a valid result
+    Match i{0, 0, nullptr};
+    bool isValid = false;
+    for (const auto &rule : m_openRules) {
+        Match res;
+        bool isOverride = false;
+        if (!nextMatch(rule, minute, res, isOverride)) {
+            return false;
+        }
+        if (isValid && isOverride) {
+            if (dayOf(res.begin) > dayOf(minute)) {
+                i = { minute, (dayOf(minute) + 1) * MinutesPerDay, nullptr };
+            } else {
+                i = res;
+            }
+        } else if (!isValid || isBefore(res.begin, res.end, i.begin, i.end)) {
+            i = res;
+        }
+        isValid = true;
+    }
+
+    // closed rules
+    auto closeEnd = i.begin;
+    auto closeBegin = i.end;
+    Match closed{0, 0, nullptr};
+    bool hasClosed = false;
+    for (const auto &rule : m_closedRules) {
+        Match j;
+        bool isOverride = false;
+        if (!nextMatch(rule, i.begin, j, isOverride)) {
+            return false;
+        }
+        if (i.end <= j.begin || j.end <= i.begin) {
+            continue;
+        }
+
+        if (j.begin <= minute && minute < j.end) {
+            if (hasClosed) {
+                closed.begin = std::min(closed.begin, j.begin);
+                closed.end = std::max(closed.end, j.end);
+            } else {
+                closed = j;
+                hasClosed = true;
+            }
+        } else if (minute < j.begin) {
+            closeBegin = std::min(j.begin, closeBegin);
+        } else if (j.end <= minute) {
+            closeEnd = std::max(closeEnd, j.end);
+        }
+    }
+    if (hasClosed) {
+        i = closed;
+    } else {
+        i.begin = closeEnd;
+        i.end = closeBegin;
+    }
+
+    result = Interval();
+    result.setBegin(toDateTime(i.begin));
+    result.setEnd(toDateTime(i.end));
+    if (i.rule) {
+        result.setState(i.rule->state);
+        result.setComment(i.rule->comment);
+    } else {
+        result.setState(Interval::Closed);
+    }
+    return true;
+}
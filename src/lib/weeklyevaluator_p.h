@@ -0,0 +1,81 @@
+/*
+    SPDX-FileCopyrightText: 2026 Volker Krause <vkrause@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.0-or-later
+*/
+
+#ifndef KOPENINGHOURS_WEEKLYEVALUATOR_P_H
+#define KOPENINGHOURS_WEEKLYEVALUATOR_P_H
+
+#include "interval.h"
+
+#include <QString>
+
+#include <memory>
+#include <vector>
+
+class QDateTime;
+
+namespace KOpeningHours {
+
+class Rule;
+
+/** Evaluator for expressions consisting only of weekly recurring rules.
+ *  That is rules made up of plain weekday ranges and fixed time spans within a single day,
+ *  without holidays, sun events, dates, weeks or years. Those are compiled into weekday and
+ *  minute-of-day tables, and evaluated with integer arithmetic on local minutes rather than
+ *  going through the selectors and QDateTime.
+ *
+ *  This mirrors the rule evaluation and combination of OpeningHours::interval() exactly,
+ *  including which interval boundaries are reported, so results are identical to the full
+ *  evaluator for the supported subset.
+ */
+class WeeklyEvaluator
+{
+public:
+    /** Compile @p rules.
+     *  @returns @c nullptr if @p rules contain anything not supported here.
+     */
+    static std::shared_ptr<const WeeklyEvaluator> compile(const std::vector<std::shared_ptr<Rule>> &rules);
+
+    /** Evaluate the rules at @p dt, see OpeningHours::interval().
+     *  This does not include the synthetic closed interval created when the result doesn't
+     *  contain @p dt.
+     *  @returns @c false if @p dt can't be handled here, e.g. due to a nearby daylight saving
+     *  time transition, in which case the full evaluator has to be used.
+     */
+    bool interval(const QDateTime &dt, Interval &result) const;
+
+private:
+    struct DayRange {
+        int beginDay; // Mo=1, ..., Su=7
+        int endDay;
+    };
+    struct TimeRange {
+        int begin; // minutes since midnight
+        int end;
+    };
+    struct CompiledRule {
+        std::vector<DayRange> days;
+        std::vector<TimeRange> times;
+        Interval::State state;
+        QString comment;
+        bool canOverride;
+    };
+    /** A rule match, in local minutes since the epoch of QDate::julianDay(). */
+    struct Match {
+        qint64 begin;
+        qint64 end;
+        const CompiledRule *rule; // @c nullptr for synthetic closed intervals
+    };
+
+    static bool compileRule(const Rule &rule, CompiledRule &compiled);
+    static bool nextMatch(const CompiledRule &rule, qint64 minute, Match &match, bool &isOverride);
+
+    std::vector<CompiledRule> m_openRules;
+    std::vector<CompiledRule> m_closedRules;
+};
+
+}
+
+#endif // KOPENINGHOURS_WEEKLYEVALUATOR_P_H
@@ -30,7 +30,7 @@ public:
 
 OpeningHours OpeningHoursFactory::parse(const QString &expression, int modes) const
 {
-    return OpeningHours(expression.toUtf8(), OpeningHours::Modes(modes));
+    return OpeningHours(QStringView(expression), OpeningHours::Modes(modes));
 }
 
 }
@@ -24,10 +24,13 @@ int main(int argc, char **argv)
 
     QCommandLineOption verifyNormalizationOpt({QStringLiteral("verify-normalization")}, QStringLiteral("verify normalized expression themselves have valid syntax"));
     parser.addOption(verifyNormalizationOpt);
+    QCommandLineOption checkOnlyOpt({QStringLiteral("check-only")}, QStringLiteral("only check for syntax errors, skip normalization and simplification"));
+    parser.addOption(checkOnlyOpt);
     parser.addPositionalArgument(QStringLiteral("expression"), QStringLiteral("OSM opening hours expression, omit for using stdin."));
     parser.process(app);
 
     const auto verifyNormalization = parser.isSet(verifyNormalizationOpt);
+    const auto checkOnly = parser.isSet(checkOnlyOpt);
     if (parser.positionalArguments().isEmpty()) {
         OpeningHours oh;
         QFile in;
@@ -36,14 +39,36 @@ int main(int argc, char **argv)
         int normalized = 0;
         int simplified = 0;
         int errors = 0;
-        char line[4096];
+        // reused for all lines, and grown as needed so there is no limit on the line length
+        QByteArray buffer(4096, Qt::Uninitialized);
         while (!in.atEnd()) {
-            auto size = in.readLine(line, sizeof(line));
-            if (size <= 1) {
+            qint64 size = 0;
+            while (true) {
+                const auto n = in.readLine(buffer.data() + size, buffer.size() - size);
+                if (n <= 0) {
+                    break;
+                }
+                size += n;
+                if (buffer[(int)size - 1] == '\n' || in.atEnd()) {
+                    break;
+                }
+                buffer.resize(buffer.size() * 2);
+            }
+            if (size > 0 && buffer[(int)size - 1] == '\n') {
+                --size; // trailing linebreak
+            }
+            if (size == 0) {
                 continue;
             }
-            --size; // trailing linebreak
+            const char *line = buffer.constData();
             ++total;
+            if (checkOnly) {
+                if (OpeningHours::check(line, size) == OpeningHours::SyntaxError) {
+                    std::cerr << "Syntax error: " << QByteArray(line, size).constData() << std::endl;
+                    ++errors;
+                }
+                continue;
+            }
             oh.setExpression(line, size);
             if (oh.error() == OpeningHours::SyntaxError) {
                 std::cerr << "Syntax error: " << QByteArray(line, size).constData() << std::endl;
@@ -74,7 +99,11 @@ int main(int argc, char **argv)
                   << simplified << " can be simplified" << std::endl;
         return errors;
     } else {
-        OpeningHours oh(parser.positionalArguments().at(0).toUtf8());
+        const auto expr = parser.positionalArguments().at(0).toUtf8();
+        if (checkOnly) {
+            return OpeningHours::check(expr) != OpeningHours::SyntaxError ? 0 : 1;
+        }
+        OpeningHours oh(expr);
         std::cout << oh.normalizedExpression().constData() << std::endl;
         return oh.error() != OpeningHours::SyntaxError ? 0 : 1;
     }